@@ -73,34 +73,46 @@ class Processor
     Processor (InputBufferType::voxel_type& DWI_vox,
         OutputBufferType::voxel_type& FOD_vox,
         Ptr<MaskBufferType::voxel_type>& mask_vox,
-        const DWI::CSDeconv<value_type>::Shared& shared) :
+        const DWI::CSDeconv<value_type>::Shared& shared,
+        size_t inner_axis) :
       dwi (DWI_vox),
       fod (FOD_vox),
       mask (mask_vox),
       sdeconv (shared),
-      data (shared.dwis.size()) {
+      row_axis (inner_axis) {
         if (mask)
           Image::check_dimensions (*mask, dwi, 0, 3);
       }
 
 
 
+    // process a whole row of voxels along the inner axis at once:
     void operator () (const Image::Iterator& pos) {
       if (!load_data (pos))
         return;
 
-      sdeconv.set (data);
+      sdeconv.set_block (data);
 
-      size_t n;
-      for (n = 0; n < sdeconv.shared.niter; n++)
-        if (sdeconv.iterate())
-          break;
-
-      if (n >= sdeconv.shared.niter)
-        INFO ("voxel [ " + str (pos[0]) + " " + str (pos[1]) + " " + str (pos[2]) +
-            " ] did not reach full convergence");
-
-      write_back (pos);
+      Image::voxel_assign (fod, pos);
+      bool converged = false;
+      for (size_t i = 0; i < voxels.size(); ++i) {
+        // warm-start from the solution in the previous voxel along the row:
+        const bool warm = converged && voxels[i] == voxels[i-1]+1;
+        converged = solve (i, warm);
+        if (!converged && warm)
+          converged = solve (i, false);
+
+        if (!converged) {
+          Image::Iterator vox (pos);
+          vox[row_axis] = voxels[i];
+          INFO ("voxel [ " + str (vox[0]) + " " + str (vox[1]) + " " + str (vox[2]) +
+              " ] did not reach full convergence");
+        }
+
+        fod[row_axis] = voxels[i];
+        for (fod[3] = 0; fod[3] < fod.dim (3); ++fod[3])
+          fod.value() = sdeconv.FOD() [fod[3]];
+      }
     }
 
 
@@ -110,39 +122,54 @@ class Processor
     OutputBufferType::voxel_type fod;
     Ptr<MaskBufferType::voxel_type> mask;
     DWI::CSDeconv<value_type> sdeconv;
-    Math::Vector<value_type> data;
+    Math::Matrix<value_type> data;
+    std::vector<ssize_t> voxels;
+    const size_t row_axis;
 
 
+    bool solve (size_t index, bool warm) {
+      sdeconv.set_voxel (index, warm);
+      for (size_t n = 0; n < sdeconv.shared.niter; n++)
+        if (sdeconv.iterate())
+          return true;
+      return false;
+    }
 
-    bool load_data (const Image::Iterator& pos) {
-      if (mask) {
-        Image::voxel_assign (*mask, pos);
-        if (!mask->value())
-          return false;
-      }
 
+    bool load_data (const Image::Iterator& pos) {
       Image::voxel_assign (dwi, pos);
+      if (mask)
+        Image::voxel_assign (*mask, pos);
 
-      for (size_t n = 0; n < sdeconv.shared.dwis.size(); n++) {
-        dwi[3] = sdeconv.shared.dwis[n];
-        data[n] = dwi.value();
-        if (!std::isfinite (data[n]))
-          return false;
-        if (data[n] < 0.0)
-          data[n] = 0.0;
+      voxels.clear();
+      data.allocate (dwi.dim (row_axis), sdeconv.shared.dwis.size());
+      for (dwi[row_axis] = 0; dwi[row_axis] < dwi.dim (row_axis); ++dwi[row_axis]) {
+        if (mask) {
+          (*mask)[row_axis] = dwi[row_axis];
+          if (!mask->value())
+            continue;
+        }
+
+        size_t n;
+        for (n = 0; n < sdeconv.shared.dwis.size(); n++) {
+          dwi[3] = sdeconv.shared.dwis[n];
+          value_type& val (data (voxels.size(), n));
+          val = dwi.value();
+          if (!std::isfinite (val))
+            break;
+          if (val < 0.0)
+            val = 0.0;
+        }
+        if (n == sdeconv.shared.dwis.size())
+          voxels.push_back (dwi[row_axis]);
       }
 
+      if (voxels.empty())
+        return false;
+      data.resize (voxels.size(), data.columns());
       return true;
     }
 
-
-
-    void write_back (const Image::Iterator& pos) {
-      Image::voxel_assign (fod, pos);
-      for (fod[3] = 0; fod[3] < fod.dim (3); ++fod[3])
-        fod.value() = sdeconv.FOD() [fod[3]];
-    }
-
 };
 
 
@@ -178,8 +205,8 @@ void run ()
   InputBufferType::voxel_type dwi_vox (dwi_buffer);
   OutputBufferType::voxel_type FOD_vox (FOD_buffer);
 
-  Processor processor (dwi_vox, FOD_vox, mask_vox, shared);
   Image::ThreadedLoop loop ("performing constrained spherical deconvolution...", dwi_vox, 1, 0, 3);
-  loop.run (processor);
+  Processor processor (dwi_vox, FOD_vox, mask_vox, shared, loop.inner_axes()[0]);
+  loop.run_outer (processor);
 }
 
@@ -136,11 +136,13 @@ class Segmented_FOD_receiver
   private:
     Image::Header H;
 
-    Ptr< Image::BufferSparse<FixelMetric> > afd_data;
+    // the buffers are shared between all copies of the receiver, while each
+    // copy (i.e. each thread) gets its own voxel accessors:
+    RefPtr< Image::BufferSparse<FixelMetric> > afd_data;
     Ptr< Image::BufferSparse<FixelMetric>::voxel_type > afd;
-    Ptr< Image::BufferSparse<FixelMetric> > peak_data;
+    RefPtr< Image::BufferSparse<FixelMetric> > peak_data;
     Ptr< Image::BufferSparse<FixelMetric>::voxel_type > peak;
-    Ptr< Image::BufferSparse<FixelMetric> > disp_data;
+    RefPtr< Image::BufferSparse<FixelMetric> > disp_data;
     Ptr< Image::BufferSparse<FixelMetric>::voxel_type > disp;
 
 
@@ -260,7 +262,8 @@ void run ()
   Segmenter fmls (dirs, lmax);
   load_fmls_thresholds (fmls);
 
-  Thread::run_queue (writer, SH_coefs(), Thread::multi (fmls), FOD_lobes(), receiver);
+  // the sparse image handler supports concurrent writes to different voxels:
+  Thread::run_queue (writer, SH_coefs(), Thread::multi (fmls), FOD_lobes(), Thread::multi (receiver));
 
 }
 
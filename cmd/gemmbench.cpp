@@ -0,0 +1,183 @@
+/*
+    Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+    Written by agent, 17/10/26.
+
+    This file is part of MRtrix.
+
+    MRtrix is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    MRtrix is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <iomanip>
+
+#include "command.h"
+#include "timer.h"
+#include "math/matrix.h"
+#include "math/gemm.h"
+
+
+using namespace MR;
+using namespace App;
+
+void usage ()
+{
+  DESCRIPTION
+  + "compare the performance of the available implementations of matrix multiplication."
+
+  + "The C BLAS routines linked with MRtrix (by default, the reference implementation "
+    "supplied with the GSL; otherwise as specified using the CBLAS_LDFLAGS environment "
+    "variable at configure time) are compared with the bundled cache-blocked "
+    "implementation (used in their place if MRtrix is configured with the -gemm option), "
+    "for the matrix shapes encountered in typical applications. Results are reported in "
+    "GFLOPS for each implementation, along with the largest relative difference between "
+    "their results.";
+
+  OPTIONS
+  + Option ("double", "perform the computations in double precision (default is single precision).")
+
+  + Option ("time", "the minimum time to spend on each computation, in seconds (default: 0.5).")
+  + Argument ("seconds").type_float (0.01, 0.5, 60.0);
+}
+
+
+
+// a matrix product to be benchmarked, either a general matrix product
+// C = op(A) op(B), or a symmetric rank-N update C = op(A) op(A)^T:
+class Shape
+{
+  public:
+    Shape (const std::string& description, size_t M, size_t N, size_t K, bool trans_A, bool trans_B, bool symmetric = false) :
+      description (description), M (M), N (N), K (K), trans_A (trans_A), trans_B (trans_B), symmetric (symmetric) { }
+
+    std::string description;
+    size_t M, N, K;
+    bool trans_A, trans_B, symmetric;
+
+    double flops () const {
+      return symmetric ? double (N) * (N+1) * K : 2.0 * M * N * K;
+    }
+};
+
+
+
+// the C BLAS routines, called directly irrespective of the configuration:
+inline void gsl_blas_gemm (CBLAS_TRANSPOSE op_A, CBLAS_TRANSPOSE op_B, float alpha, const Math::Matrix<float>& A, const Math::Matrix<float>& B, float beta, Math::Matrix<float>& C) 
+{
+  gsl_blas_sgemm (op_A, op_B, alpha, A.gsl(), B.gsl(), beta, C.gsl());
+}
+inline void gsl_blas_gemm (CBLAS_TRANSPOSE op_A, CBLAS_TRANSPOSE op_B, double alpha, const Math::Matrix<double>& A, const Math::Matrix<double>& B, double beta, Math::Matrix<double>& C) 
+{
+  gsl_blas_dgemm (op_A, op_B, alpha, A.gsl(), B.gsl(), beta, C.gsl());
+}
+inline void gsl_blas_syrk (CBLAS_UPLO uplo, CBLAS_TRANSPOSE op_A, float alpha, const Math::Matrix<float>& A, float beta, Math::Matrix<float>& C) 
+{
+  gsl_blas_ssyrk (uplo, op_A, alpha, A.gsl(), beta, C.gsl());
+}
+inline void gsl_blas_syrk (CBLAS_UPLO uplo, CBLAS_TRANSPOSE op_A, double alpha, const Math::Matrix<double>& A, double beta, Math::Matrix<double>& C) 
+{
+  gsl_blas_dsyrk (uplo, op_A, alpha, A.gsl(), beta, C.gsl());
+}
+
+
+
+template <typename ValueType>
+double gflops (const Shape& shape, bool bundled, Math::Matrix<ValueType>& A, Math::Matrix<ValueType>& B, Math::Matrix<ValueType>& C, double min_time)
+{
+  const CBLAS_TRANSPOSE op_A = shape.trans_A ? CblasTrans : CblasNoTrans;
+  const CBLAS_TRANSPOSE op_B = shape.trans_B ? CblasTrans : CblasNoTrans;
+  size_t count = 0;
+  Timer timer;
+  do {
+    if (bundled) 
+      Math::GEMM::gemm (shape.trans_A, shape.trans_B, shape.M, shape.N, shape.K,
+          ValueType (1.0), A.ptr(), A.row_stride(), B.ptr(), B.row_stride(), ValueType (0.0), C.ptr(), C.row_stride(),
+          shape.symmetric ? Math::GEMM::Lower : Math::GEMM::Full);
+    else if (shape.symmetric) 
+      gsl_blas_syrk (CblasLower, op_A, ValueType (1.0), A, ValueType (0.0), C);
+    else
+      gsl_blas_gemm (op_A, op_B, ValueType (1.0), A, B, ValueType (0.0), C);
+    ++count;
+  } while (timer.elapsed() < min_time);
+  return 1.0e-9 * shape.flops() * count / timer.elapsed();
+}
+
+
+
+template <typename ValueType>
+void benchmark (const Shape& shape, double min_time)
+{
+  Math::Matrix<ValueType> A (shape.trans_A ? shape.K : shape.M, shape.trans_A ? shape.M : shape.K);
+  Math::Matrix<ValueType> B (shape.trans_B ? shape.N : shape.K, shape.trans_B ? shape.K : shape.N);
+  Math::Matrix<ValueType> C_blas (shape.M, shape.N), C_bundled (shape.M, shape.N);
+  for (size_t i = 0; i < A.rows(); ++i)
+    for (size_t j = 0; j < A.columns(); ++j)
+      A(i,j) = std::sin (ValueType (1 + 3*i + 7*j));
+  for (size_t i = 0; i < B.rows(); ++i)
+    for (size_t j = 0; j < B.columns(); ++j)
+      B(i,j) = std::cos (ValueType (2 + 5*i + 3*j));
+  C_blas.zero();
+  C_bundled.zero();
+
+  const double blas = gflops (shape, false, A, shape.symmetric ? A : B, C_blas, min_time);
+  const double bundled = gflops (shape, true, A, shape.symmetric ? A : B, C_bundled, min_time);
+
+  double max_diff = 0.0, max_value = 0.0;
+  for (size_t i = 0; i < shape.M; ++i) {
+    for (size_t j = 0; j < (shape.symmetric ? i+1 : shape.N); ++j) {
+      max_diff = std::max (max_diff, double (std::abs (C_blas(i,j) - C_bundled(i,j))));
+      max_value = std::max (max_value, double (std::abs (C_blas(i,j))));
+    }
+  }
+
+  std::cout << std::setw (48) << std::left << shape.description << std::right
+    << std::setw (6) << shape.M << std::setw (7) << shape.N << std::setw (6) << shape.K
+    << std::fixed << std::setprecision (2) << std::setw (10) << blas << std::setw (10) << bundled
+    << std::scientific << std::setprecision (1) << std::setw (10) << (max_value > 0.0 ? max_diff / max_value : 0.0) 
+    << "\n";
+}
+
+
+
+void run ()
+{
+  double min_time = 0.5;
+  Options opt = get_options ("time");
+  if (opt.size())
+    min_time = opt[0][0];
+
+  std::vector<Shape> shapes;
+  shapes.push_back (Shape ("CSD: normal matrix, 60 directions, lmax=8", 45, 45, 60, true, false, true));
+  shapes.push_back (Shape ("CSD: constraint update, 150 negative lobes", 45, 45, 150, true, false, true));
+  shapes.push_back (Shape ("amp2sh: lmax=8, 60 directions, 1000 voxels", 45, 1000, 60, false, false));
+  shapes.push_back (Shape ("sh2amp: lmax=8, 300 directions, 1000 voxels", 300, 1000, 45, false, false));
+  shapes.push_back (Shape ("dwi2tensor: 60 directions, 1000 voxels", 7, 1000, 60, false, false));
+  shapes.push_back (Shape ("GLM: betas, 40 subjects, 4 factors", 100000, 4, 40, false, true));
+  shapes.push_back (Shape ("GLM: residuals, 40 subjects, 4 factors", 100000, 40, 4, false, true));
+  shapes.push_back (Shape ("GLM: pseudo-inverse, 40 subjects, 4 factors", 4, 4, 40, true, false));
+  shapes.push_back (Shape ("large square", 1000, 1000, 1000, false, false));
+
+  const bool use_double = get_options ("double").size();
+  std::cout << std::setw (48) << std::left << (use_double ? "shape (double precision)" : "shape (single precision)") << std::right
+    << std::setw (6) << "M" << std::setw (7) << "N" << std::setw (6) << "K"
+    << std::setw (10) << "C BLAS" << std::setw (10) << "bundled" << std::setw (10) << "rel. diff" << "\n";
+
+  for (size_t n = 0; n < shapes.size(); ++n) {
+    if (use_double)
+      benchmark<double> (shapes[n], min_time);
+    else
+      benchmark<float> (shapes[n], min_time);
+  }
+}
+
@@ -24,6 +24,8 @@
 #include "image/buffer.h"
 #include "image/voxel.h"
 #include "image/loop.h"
+#include "image/stride.h"
+#include "image/virtual.h"
 #include "progressbar.h"
 
 
@@ -52,6 +54,15 @@ OPTIONS
   "of the input images")
   + Argument ("axis").type_integer (0, std::numeric_limits<int>::max(), std::numeric_limits<int>::max())
 
+  + Option ("virtual",
+  "write the output as a header-only image referencing the data of the input "
+  "images, rather than copying them, where possible. This is only possible if "
+  "the output is in MRtrix format (.mif or .mih), the input data are stored "
+  "uncompressed with matching data types, intensity scaling and strides, and "
+  "concatenation is performed along the outermost axis of each input image. "
+  "Note that the output image will only remain valid for as long as the "
+  "input images are left in place and unmodified.")
+
   + DataType::options();
 }
 
@@ -59,6 +70,90 @@ OPTIONS
 typedef float value_type;
 
 
+
+// the order and direction in which the data of an image are stored along
+// each non-singleton axis other than the concatenation axis, as symbolic
+// strides over the output axes (zero for axes that play no part):
+std::vector<ssize_t> layout (const Image::Header& H, const Image::Virtual::Slabs& slabs, size_t axis, size_t ndims)
+{
+  std::vector<ssize_t> strides (ndims, 0);
+  for (size_t i = 0; i < std::min (ndims, H.ndim()); ++i) {
+    if (i == axis || H.dim (i) <= 1)
+      continue;
+    // slabs are always appended in the forward direction:
+    strides[i] = i == slabs.axis() ? std::abs (H.stride (i)) : H.stride (i);
+  }
+
+  std::vector<ssize_t> symbolic (ndims, 0);
+  for (size_t i = 0; i < ndims; ++i) {
+    if (!strides[i])
+      continue;
+    ssize_t rank = 1;
+    for (size_t j = 0; j < ndims; ++j)
+      if (strides[j] && std::abs (strides[j]) < std::abs (strides[i]))
+        ++rank;
+    symbolic[i] = strides[i] < 0 ? -rank : rank;
+  }
+  return symbolic;
+}
+
+
+
+// write the output as a virtual image, if possible:
+bool write_virtual (const std::vector<Ptr<Image::Buffer<value_type> > >& in,
+    const Image::Header& header_out, size_t axis, const std::string& output_filename)
+{
+  if (!Image::Virtual::supported (output_filename))
+    return false;
+
+  std::vector<ssize_t> strides;
+  VecPtr<Image::Virtual::Slabs> slabs;
+  for (size_t n = 0; n < in.size(); ++n) {
+    const Image::Buffer<value_type>& H (*in[n]);
+    slabs.push_back (new Image::Virtual::Slabs (H));
+    if (!slabs[n]->valid())
+      return false;
+    if (H.datatype() != header_out.datatype() ||
+        H.intensity_offset() != in[0]->intensity_offset() ||
+        H.intensity_scale() != in[0]->intensity_scale())
+      return false;
+    // the data along the concatenation axis must be stored in separate slabs:
+    if (axis < H.ndim() && H.dim (axis) > 1 && slabs[n]->axis() != axis)
+      return false;
+    const std::vector<ssize_t> S (layout (H, *slabs[n], axis, header_out.ndim()));
+    if (n == 0)
+      strides = S;
+    else if (S != strides)
+      return false;
+  }
+
+  // remaining (singleton) axes go after those holding data, and the
+  // concatenation axis last:
+  Image::Header header (header_out);
+  header.set_intensity_scaling (*in[0]);
+  header.name() = output_filename;
+  ssize_t next_stride = 1;
+  for (size_t i = 0; i < header.ndim(); ++i)
+    if (strides[i])
+      ++next_stride;
+  for (size_t i = 0; i < header.ndim(); ++i)
+    if (i != axis && !strides[i])
+      strides[i] = next_stride++;
+  strides[axis] = next_stride;
+  for (size_t i = 0; i < header.ndim(); ++i)
+    header.stride(i) = strides[i];
+
+  Image::Virtual::RangeList ranges;
+  for (size_t n = 0; n < in.size(); ++n)
+    for (size_t i = 0; i < slabs[n]->size(); ++i)
+      slabs[n]->append (i, ranges);
+
+  Image::Virtual::create (header, ranges);
+  return true;
+}
+
+
+
 void run () {
   int axis = -1;
 
@@ -146,6 +241,9 @@ void run () {
 
 
 
+  if (get_options ("virtual").size() && write_virtual (in, header_out, axis, argument[num_images]))
+    return;
+
   Image::Buffer<value_type> data_out (argument[num_images], header_out);
   Image::Buffer<value_type>::voxel_type out_vox (data_out);
 
@@ -22,6 +22,7 @@
 
 #include "command.h"
 #include "progressbar.h"
+#include "timer.h"
 #include "image/buffer.h"
 #include "image/voxel.h"
 #include "image/axis.h"
@@ -29,6 +30,7 @@
 #include "image/adapter/extract.h"
 #include "image/adapter/permute_axes.h"
 #include "image/stride.h"
+#include "image/virtual.h"
 #include "dwi/gradient.h"
 
 
@@ -75,6 +77,15 @@ void usage ()
   + Option ("zero",
             "replace non-finite values with zeros.")
 
+  + Option ("virtual",
+            "write the output as a header-only image referencing the data of the input "
+            "image, rather than copying them, where possible. This is only possible if "
+            "the output is in MRtrix format (.mif or .mih), the input data are stored "
+            "uncompressed, no change in data type or strides is requested, and any "
+            "coordinates selected lie along the outermost axis of the input image. "
+            "Note that the output image will only remain valid for as long as the "
+            "input image is left in place and unmodified.")
+
   + Option ("prs",
             "assume that the DW gradients are specified in the PRS frame (Siemens DICOM only).")
 
@@ -201,8 +212,82 @@ inline void copy_permute (InputVoxelType& in, Image::Header& header_out, const s
 
 
 
+// write the output as a virtual image, if possible:
+inline bool write_virtual (
+  const Image::Header& header_in,
+  const Image::Header& header_out,
+  const std::vector<std::vector<int> >& pos,
+  const std::string& output_filename)
+{
+  if (!Image::Virtual::supported (output_filename) || get_options ("zero").size() || get_options ("stride").size())
+    return false;
+
+  Image::Virtual::Slabs slabs (header_in);
+  if (!slabs.valid())
+    return false;
+
+  // only the outermost axis can be subsampled; all others must be
+  // selected in full, in order:
+  for (size_t n = 0; n < pos.size(); ++n) {
+    if (n == slabs.axis())
+      continue;
+    if (pos[n].size() != size_t (header_in.dim (n)))
+      return false;
+    for (size_t i = 0; i < pos[n].size(); ++i)
+      if (pos[n][i] != int (i))
+        return false;
+  }
+
+  if (header_out.datatype() != header_in.datatype())
+    return false;
+
+  Image::Header header (header_out);
+  std::vector<int> axes = set_header (header, header_in);
+  header.set_intensity_scaling (header_in);
+  header.name() = output_filename;
+
+  if (axes.empty())
+    for (size_t n = 0; n < header_in.ndim(); ++n)
+      axes.push_back (n);
+
+  // data for all input axes must be present in the output:
+  for (size_t n = 0; n < header_in.ndim(); ++n)
+    if (std::find (axes.begin(), axes.end(), int (n)) == axes.end() && header_in.dim (n) > 1)
+      return false;
+
+  // the slabs will be stored in the order requested, so the outermost axis
+  // must be traversed in the forward direction. Inserted axes go last:
+  ssize_t next_stride = header_in.ndim() + 1;
+  for (size_t i = 0; i < axes.size(); ++i) {
+    if (axes[i] < 0) {
+      header.stride(i) = next_stride++;
+      continue;
+    }
+    header.stride(i) = header_in.stride (axes[i]);
+    if (size_t (axes[i]) == slabs.axis())
+      header.stride(i) = std::abs (header.stride(i));
+    if (pos.size() && pos[axes[i]].size())
+      header.dim(i) = pos[axes[i]].size();
+  }
+
+  Image::Virtual::RangeList ranges;
+  if (pos.size() && pos[slabs.axis()].size())
+    for (size_t i = 0; i < pos[slabs.axis()].size(); ++i)
+      slabs.append (pos[slabs.axis()][i], ranges);
+  else
+    for (size_t i = 0; i < slabs.size(); ++i)
+      slabs.append (i, ranges);
+
+  Image::Virtual::create (header, ranges);
+  return true;
+}
+
+
+
+
 void run ()
 {
+  Timer timer;
   Image::Header header_in (argument[0]);
 
   Image::Buffer<complex_type> buffer_in (header_in);
@@ -214,6 +299,8 @@ void run ()
   if (header_in.datatype().is_complex() && !header_out.datatype().is_complex())
     WARN ("requested datatype is real but input datatype is complex - imaginary component will be ignored");
 
+  const bool virtual_output = get_options ("virtual").size();
+
 
   Options opt = get_options ("coord");
   if (opt.size()) {
@@ -245,11 +332,18 @@ void run ()
       }
     }
 
+    if (virtual_output && write_virtual (header_in, header_out, pos, argument[1]))
+      return;
+
     Image::Adapter::Extract<Image::Buffer<complex_type>::voxel_type> extract (in, pos);
     copy_permute (extract, header_out, argument[1]);
   }
-  else
+  else {
+    if (virtual_output && write_virtual (header_in, header_out, std::vector<std::vector<int> >(), argument[1]))
+      return;
     copy_permute (in, header_out, argument[1]);
+  }
 
+  INFO ("conversion of \"" + shorten (header_in.name()) + "\" completed in " + str (timer.elapsed()) + " seconds");
 }
 
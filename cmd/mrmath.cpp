@@ -24,6 +24,7 @@
 #include "progressbar.h"
 #include "ptr.h"
 #include "image/buffer.h"
+#include "image/buffer_direct.h"
 #include "image/buffer_preload.h"
 #include "image/buffer_scratch.h"
 #include "image/iterator.h"
@@ -288,6 +289,19 @@ class ImageKernel : public ImageKernelBase {
             out.value() = op.result(); 
           } 
     };
+    class ProcessImage {
+      public:
+        ProcessImage (Image::BufferScratch<Operation>& buffer) : buffer (buffer) { }
+        template <class InputVoxelType>
+          void operator() (InputVoxelType& v_in) {
+            for (size_t axis = buffer.ndim(); axis < v_in.ndim(); ++axis)
+              v_in[axis] = 0;
+            typename Image::BufferScratch<Operation>::voxel_type v_buffer (buffer);
+            Image::ThreadedLoop (v_buffer).run (ProcessFunctor(), v_buffer, v_in);
+          }
+      protected:
+        Image::BufferScratch<Operation>& buffer;
+    };
 
   public:
     ImageKernel (const Image::Header& header, const std::string& path) :
@@ -310,11 +324,8 @@ class ImageKernel : public ImageKernelBase {
     void process (const Image::Header& image_in)
     {
       Image::Buffer<value_type> in (image_in);
-      Image::Buffer<value_type>::voxel_type v_in (in);
-      for (size_t axis = buffer.ndim(); axis < v_in.ndim(); ++axis)
-        v_in[axis] = 0;
-      typename Image::BufferScratch<Operation>::voxel_type v_buffer (buffer);
-      Image::ThreadedLoop (v_buffer).run (ProcessFunctor(), v_buffer, v_in);
+      ProcessImage process_image (buffer);
+      Image::direct_access (in, process_image);
     }
 
   protected:
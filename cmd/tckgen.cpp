@@ -155,6 +155,10 @@ void run ()
 
   Tracking::load_streamline_properties (properties);
 
+  // The FOD amplitude cache is only used by the iFOD algorithms
+  if (properties.find ("fod_cache_dirs") != properties.end() && algorithm != 1 && algorithm != 2)
+    throw Exception ("Option -fod_cache is only valid for the iFOD1 & iFOD2 algorithms");
+
   ACT::load_act_properties (properties);
 
   Seeding::load_tracking_seeds (properties);
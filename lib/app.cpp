@@ -49,6 +49,8 @@ namespace MR
                                      + Option ("force", "force overwrite of output files.")
                                      + Option ("nthreads", "use this number of threads in multi-threaded applications")
                                        + Argument ("number").type_integer (0, 1, std::numeric_limits<int>::max())
+                                     + Option ("queuestats", "report the throughput, stall time and occupancy of the queues "
+                                         "between the stages of multi-threaded pipelines when the command exits")
                                      + Option ("failonwarn", "terminate program if a warning is produced")
                                      + Option ("help", "display this information page and exit.")
                                      + Option ("version", "display version information and exit.");
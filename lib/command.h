@@ -26,6 +26,19 @@
 
 #include "project_version.h"
 #include "app.h"
+#include "file/write_behind.h"
+
+// If the command fails, outputs may still be being written in the background:
+//   wait for these before exiting, and report any error they produce too.
+inline void __finish_writes_after_error ()
+{
+  try {
+    MR::File::WriteBehind::finish ();
+  }
+  catch (MR::Exception& E) {
+    E.display();
+  }
+}
 
 #ifdef MRTRIX_AS_R_LIBRARY
 
@@ -45,12 +58,15 @@ extern "C" void R_main (int* cmdline_argc, char** cmdline_argv)
     MR::App::init (*cmdline_argc, cmdline_argv); 
     MR::App::parse (); 
     run (); 
+    MR::File::WriteBehind::finish ();
   } 
   catch (MR::Exception& E) { 
     E.display(); 
+    __finish_writes_after_error ();
     return; 
   } 
   catch (int retval) { 
+    __finish_writes_after_error ();
     return; 
   } 
 } 
@@ -79,12 +95,15 @@ int main (int cmdline_argc, char** cmdline_argv)
     usage (); 
     MR::App::parse (); 
     run (); 
+    MR::File::WriteBehind::finish ();
   } 
   catch (MR::Exception& E) { 
     E.display(); 
+    __finish_writes_after_error ();
     return 1;
   } 
   catch (int retval) { 
+    __finish_writes_after_error ();
     return retval; 
   } 
   return 0; 
@@ -37,7 +37,7 @@ namespace MR {
         is_BE = is_transfer_syntax_BE = false;
         parents.clear();
 
-        fmap = new File::MMap (filename, read_write);
+        fmap = new File::MMap (filename, read_write, true, -1, File::MMap::Sequential);
 
         if (fmap->size() < 256) 
           throw Exception ("\"" + fmap->name() + "\" is too small to be a valid DICOM file");
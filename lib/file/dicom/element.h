@@ -75,10 +75,17 @@ namespace MR {
 
           std::string tag_name () const {
             if (dict.empty()) init_dict();
-            const char* s = dict[tag()];
-            return (s ? s : "");
+            // don't use operator[] here: it would insert missing entries,
+            // which is not safe when scanning files from multiple threads:
+            UnorderedMap<uint32_t, const char*>::Type::const_iterator entry = dict.find (tag());
+            return (entry != dict.end() && entry->second ? entry->second : "");
           }
 
+          //! initialise the DICOM dictionary
+          /*! this is done automatically on first use, but must be invoked
+           * explicitly before reading files from multiple threads. */
+          static void init_dict();
+
           uint32_t tag () const {
             union __DICOM_group_element_pair__ { uint16_t s[2]; uint32_t i; } val = { {
 #if MRTRIX_BYTE_ORDER_BIG_ENDIAN
@@ -130,7 +137,6 @@ namespace MR {
           }
 
           static UnorderedMap<uint32_t, const char*>::Type dict;
-          static void init_dict();
 
           void report_unknown_tag_with_implicit_syntax () const {
             DEBUG (MR::printf ("attempt to read data of unknown value representation "
@@ -31,7 +31,13 @@
 */
 
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fstream>
+
 #include "file/path.h"
+#include "file/config.h"
+#include "thread/queue.h"
 #include "file/dicom/element.h"
 #include "file/dicom/quick_scan.h"
 #include "file/dicom/image.h"
@@ -71,23 +77,124 @@ namespace MR {
 
 
 
-      void Tree::read_dir (const std::string& filename, ProgressBar& progress)
+      // a file found while scanning a DICOM folder, along with the details
+      // needed to check whether its entry in the scan index is up to date:
+      class Tree::ScanEntry
       {
-        try { 
-          Path::Dir folder (filename); 
-          std::string entry;
-          while ((entry = folder.read_name()).size()) {
-            std::string name (Path::join (filename, entry));
-            if (Path::is_dir (name))
-              read_dir (name, progress);
-            else {
-              try { 
-                read_file (name); 
+        public:
+          ScanEntry (const std::string& filename, const struct stat& sbuf) :
+            size (sbuf.st_size), mtime (sbuf.st_mtime), scanned (false), is_image (false) {
+              reader.filename = filename;
+            }
+
+          int64_t size, mtime;
+          bool scanned, is_image;
+          QuickScan reader;
+
+          void scan () {
+            is_image = false;
+            scanned = true;
+            if (reader.read (reader.filename)) {
+              INFO ("error reading file \"" + reader.filename + "\" - assuming not DICOM"); 
+              return;
+            }
+            if (! (reader.dim[0] && reader.dim[1] && reader.bits_alloc && reader.data)) {
+              INFO ("DICOM file \"" + reader.filename + "\" does not seem to contain image data - ignored"); 
+              return;
+            }
+            is_image = true;
+          }
+      };
+
+
+
+
+
+      //! \cond skip
+      namespace {
+
+        // the scan index holds one line per file, with tab-separated fields:
+        const char* index_file_name = ".mrtrix-dicom-index";
+        const char* index_first_line = "mrtrix DICOM index 1";
+        const size_t index_num_fields = 17;
+
+        inline std::string index_field (const std::string& value)
+        {
+          std::string ret (value);
+          for (size_t n = 0; n < ret.size(); ++n)
+            if (ret[n] == '\t' || ret[n] == '\n' || ret[n] == '\r')
+              ret[n] = ' ';
+          return ret;
+        }
+
+
+
+        // scan the files listed, in multiple threads:
+        class Scanner
+        {
+          public:
+            Scanner (std::vector<Tree::ScanEntry>& files, const std::vector<size_t>& list) : 
+              files (files), list (list), next (0) { }
+            bool operator() (size_t& index) {
+              if (next >= list.size())
+                return false;
+              index = list[next++];
+              return true;
+            }
+            std::vector<Tree::ScanEntry>& files;
+            const std::vector<size_t>& list;
+            size_t next;
+        };
+
+        class ScanFile
+        {
+          public:
+            ScanFile (std::vector<Tree::ScanEntry>& files) : files (files) { }
+            bool operator() (const size_t& index, size_t& out) {
+              try {
+                files[index].scan(); 
               }
               catch (Exception& E) { 
                 E.display (3);
               }
+              out = index;
+              return true;
             }
+            std::vector<Tree::ScanEntry>& files;
+        };
+
+        class ScanProgress
+        {
+          public:
+            ScanProgress (ProgressBar& progress) : progress (progress) { }
+            bool operator() (const size_t& index) {
+              ++progress;
+              return true;
+            }
+            ProgressBar& progress;
+        };
+
+      }
+      //! \endcond
+
+
+
+
+
+      void Tree::read_dir (const std::string& filename, std::vector<ScanEntry>& files, ProgressBar& progress)
+      {
+        try { 
+          Path::Dir folder (filename); 
+          std::string entry;
+          while ((entry = folder.read_name()).size()) {
+            std::string name (Path::join (filename, entry));
+            struct stat sbuf;
+            if (stat (name.c_str(), &sbuf))
+              continue;
+            if (S_ISDIR (sbuf.st_mode))
+              read_dir (name, files, progress);
+            else if (entry != index_file_name) 
+              files.push_back (ScanEntry (name, sbuf));
             ++progress;
           }
         }
@@ -113,12 +220,21 @@ namespace MR {
           return;
         }
 
+        add (reader);
+      }
+
+
+
+
+
+      void Tree::add (const QuickScan& reader)
+      {
         RefPtr<Patient> patient = find (reader.patient, reader.patient_ID, reader.patient_DOB);
         RefPtr<Study> study = patient->find (reader.study, reader.study_ID, reader.study_date, reader.study_time);
         RefPtr<Series> series = study->find (reader.series, reader.series_number, reader.modality, reader.series_date, reader.series_time);
 
         RefPtr<Image> image (new Image);
-        image->filename = filename;
+        image->filename = reader.filename;
         image->series = series;
         image->sequence_name = reader.sequence;
         series->push_back (image);
@@ -130,16 +246,55 @@ namespace MR {
 
       void Tree::read (const std::string& filename)
       {
-        ProgressBar progress ("scanning DICOM folder \"" + shorten (filename) + "\"", 0);
-        if (Path::is_dir (filename))
-          read_dir (filename, progress);
-        else {
+        if (!Path::is_dir (filename)) {
           try {
             read_file (filename);
           }
           catch (Exception) { 
           }
         }
+        else {
+          std::vector<ScanEntry> files;
+          {
+            ProgressBar progress ("scanning DICOM folder \"" + shorten (filename) + "\"", 0);
+            read_dir (filename, files, progress);
+          }
+
+          //CONF option: DICOM.ScanIndex
+          //CONF default: 0 (false)
+          //CONF whether to store the results of scanning a DICOM folder in
+          //CONF an index file within that folder (named .mrtrix-dicom-index).
+          //CONF Subsequent scans of the same folder will then only need to
+          //CONF read those files that have been added or modified since.
+          const bool use_index = File::Config::get_bool ("DICOM.ScanIndex", false);
+          const std::string index_path (Path::join (filename, index_file_name));
+          if (use_index)
+            read_index (index_path, files);
+
+          std::vector<size_t> to_scan;
+          for (size_t n = 0; n < files.size(); ++n)
+            if (!files[n].scanned) 
+              to_scan.push_back (n);
+
+          if (to_scan.size()) {
+            ProgressBar progress ("reading DICOM headers in \"" + shorten (filename) + "\"", to_scan.size());
+            // the DICOM dictionary must be initialised before use from multiple threads:
+            Element::init_dict();
+            Scanner source (files, to_scan);
+            ScanFile scan (files);
+            ScanProgress sink (progress);
+            Thread::run_queue (source, size_t(), Thread::multi (scan), size_t(), sink);
+          }
+
+          // build the tree in the order the files were found, so that the
+          // outcome does not depend on the order in which they were scanned:
+          for (size_t n = 0; n < files.size(); ++n)
+            if (files[n].is_image)
+              add (files[n].reader);
+
+          if (use_index && to_scan.size())
+            write_index (index_path, files);
+        }
 
         if (size() > 0) 
           return;
@@ -152,6 +307,100 @@ namespace MR {
 
 
 
+      void Tree::read_index (const std::string& path, std::vector<ScanEntry>& files)
+      {
+        std::ifstream in (path.c_str());
+        if (!in)
+          return;
+
+        std::string line;
+        getline (in, line);
+        if (line != index_first_line) {
+          INFO ("ignoring DICOM scan index \"" + path + "\" with unexpected format");
+          return;
+        }
+
+        std::map<std::string,size_t> entries;
+        const std::string folder (Path::dirname (path));
+        for (size_t n = 0; n < files.size(); ++n)
+          entries[files[n].reader.filename.substr (folder.size()+1)] = n;
+
+        size_t count = 0;
+        while (getline (in, line)) {
+          std::vector<std::string> V (split (line, "\t", false));
+          if (V.size() != index_num_fields)
+            continue;
+          std::map<std::string,size_t>::const_iterator entry = entries.find (V[0]);
+          if (entry == entries.end())
+            continue;
+          ScanEntry& file (files[entry->second]);
+          try {
+            if (to<int64_t> (V[1]) != file.size || to<int64_t> (V[2]) != file.mtime)
+              continue;
+            file.is_image = to<int> (V[3]);
+            QuickScan& reader (file.reader);
+            reader.patient = V[4];
+            reader.patient_ID = V[5];
+            reader.patient_DOB = V[6];
+            reader.study = V[7];
+            reader.study_ID = V[8];
+            reader.study_date = V[9];
+            reader.study_time = V[10];
+            reader.series = V[11];
+            reader.series_number = to<size_t> (V[12]);
+            reader.modality = V[13];
+            reader.series_date = V[14];
+            reader.series_time = V[15];
+            reader.sequence = V[16];
+            file.scanned = true;
+            ++count;
+          }
+          catch (Exception) { 
+          }
+        }
+
+        INFO ("found " + str (count) + " up to date entries in DICOM scan index \"" + path + "\"");
+      }
+
+
+
+
+
+      void Tree::write_index (const std::string& path, const std::vector<ScanEntry>& files) const
+      {
+        std::ofstream out (path.c_str());
+        if (!out) {
+          INFO ("unable to write DICOM scan index \"" + path + "\": " + strerror (errno));
+          return;
+        }
+
+        const std::string folder (Path::dirname (path));
+        out << index_first_line << "\n";
+        for (size_t n = 0; n < files.size(); ++n) {
+          const ScanEntry& file (files[n]);
+          if (!file.scanned)
+            continue;
+          const QuickScan& reader (file.reader);
+          out << index_field (reader.filename.substr (folder.size()+1)) << "\t" 
+            << file.size << "\t" << file.mtime << "\t" << int (file.is_image) << "\t"
+            << index_field (reader.patient) << "\t" << index_field (reader.patient_ID) << "\t" 
+            << index_field (reader.patient_DOB) << "\t" << index_field (reader.study) << "\t" 
+            << index_field (reader.study_ID) << "\t" << index_field (reader.study_date) << "\t" 
+            << index_field (reader.study_time) << "\t" << index_field (reader.series) << "\t" 
+            << reader.series_number << "\t" << index_field (reader.modality) << "\t" 
+            << index_field (reader.series_date) << "\t" << index_field (reader.series_time) << "\t" 
+            << index_field (reader.sequence) << "\n";
+        }
+
+        if (!out.good())
+          INFO ("error writing DICOM scan index \"" + path + "\"");
+      }
+
+
+
+
+
+
       std::ostream& operator<< (std::ostream& stream, const Tree& item)
       { 
         stream << "FileSet " << item.description << ":\n";
@@ -25,6 +25,7 @@
 
 #include "ptr.h"
 #include "file/dicom/patient.h"
+#include "file/dicom/quick_scan.h"
 
 namespace MR {
   namespace File {
@@ -48,9 +49,14 @@ namespace MR {
             }
           }
 
+          class ScanEntry;
+
         protected:
-          void read_dir (const std::string& filename, ProgressBar& progress);
+          void read_dir (const std::string& filename, std::vector<ScanEntry>& files, ProgressBar& progress);
           void read_file (const std::string& filename);
+          void add (const QuickScan& reader);
+          void read_index (const std::string& path, std::vector<ScanEntry>& files);
+          void write_index (const std::string& path, const std::vector<ScanEntry>& files) const;
       }; 
 
       std::ostream& operator<< (std::ostream& stream, const Tree& item);
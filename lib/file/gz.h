@@ -35,6 +35,7 @@
 #include "types.h"
 #include "exception.h"
 #include "file/path.h"
+#include "file/write_behind.h"
 
 namespace MR
 {
@@ -62,6 +63,10 @@ namespace MR
           if (!MR::Path::exists (filename))
             throw Exception ("cannot access file \"" + filename + "\": No such file or directory");
 
+          // the file may still be being written in the background:
+          if (mode[0] == 'r')
+            WriteBehind::finish();
+
           gz = gzopen (filename.c_str(), mode);
           if (!gz)
             throw Exception ("error opening file \"" + filename + "\": insufficient memory");
@@ -0,0 +1,395 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "exception.h"
+#include "progressbar.h"
+#include "file/gz_blocks.h"
+#include "file/write_behind.h"
+#include "thread/exec.h"
+#include "thread/mutex.h"
+
+#define GZ_BLOCK_HEADER_SIZE 24
+#define GZ_BLOCK_TRAILER_SIZE 8
+
+namespace MR
+{
+  namespace File
+  {
+    namespace GZBlocks
+    {
+
+      namespace {
+
+        inline void put16 (uint8_t* p, uint32_t value)
+        {
+          p[0] = value & 0xFFU;
+          p[1] = (value >> 8) & 0xFFU;
+        }
+
+        inline void put32 (uint8_t* p, uint32_t value)
+        {
+          put16 (p, value);
+          put16 (p+2, value >> 16);
+        }
+
+        inline uint32_t get16 (const uint8_t* p)
+        {
+          return uint32_t (p[0]) | (uint32_t (p[1]) << 8);
+        }
+
+        inline uint32_t get32 (const uint8_t* p)
+        {
+          return get16 (p) | (get16 (p+2) << 16);
+        }
+
+
+
+        // gzip member header, with an 'MR' extra subfield holding the total
+        // size of the member and the size of its uncompressed data:
+        void put_header (uint8_t* p, uint32_t member_size, uint32_t data_size)
+        {
+          p[0] = 0x1F; p[1] = 0x8B;  // gzip magic number
+          p[2] = 8;                  // compression method: deflate
+          p[3] = 4;                  // flags: FEXTRA
+          put32 (p+4, 0);            // modification time
+          p[8] = 0;                  // extra flags
+          p[9] = 255;                // operating system: unknown
+          put16 (p+10, 12);          // XLEN
+          p[12] = 'M'; p[13] = 'R';  // subfield identifier
+          put16 (p+14, 8);           // subfield length
+          put32 (p+16, member_size);
+          put32 (p+20, data_size);
+        }
+
+        bool is_block_header (const uint8_t* p)
+        {
+          return p[0] == 0x1F && p[1] == 0x8B && p[2] == 8 && p[3] == 4 &&
+            get16 (p+10) == 12 && p[12] == 'M' && p[13] == 'R' && get16 (p+14) == 8;
+        }
+
+
+
+
+        class Shared
+        {
+          public:
+            Shared (size_t number_of_jobs, ProgressBar* progress_bar) :
+              num_jobs (number_of_jobs), next (0), progress (progress_bar) { }
+
+            const size_t num_jobs;
+            volatile size_t next;
+            ProgressBar* progress;
+            Thread::Mutex mutex;
+            std::string error;
+
+            bool get_job (size_t& n) {
+              n = __sync_fetch_and_add (&next, 1);
+              return n < num_jobs;
+            }
+            void set_error (const Exception& E) {
+              Thread::Mutex::Lock lock (mutex);
+              if (error.empty())
+                error = E.description.size() ? E.description.back() : "unknown error";
+              next = num_jobs;
+            }
+            void done () {
+              if (!progress) return;
+              Thread::Mutex::Lock lock (mutex);
+              ++(*progress);
+            }
+            void check () const {
+              if (error.size())
+                throw Exception (error);
+            }
+        };
+
+
+        template <class Job>
+          void run_jobs (Job& job)
+          {
+            if (Thread::number_of_threads() > 1) {
+              Thread::Array<Job> jobs (job);
+              Thread::Exec threads (jobs, "gzip threads");
+            }
+            else
+              job.execute();
+          }
+
+
+
+
+        class Block
+        {
+          public:
+            Block (const uint8_t* data, size_t size) : in (data), in_size (size) { }
+            const uint8_t* in;
+            size_t in_size;
+            std::vector<uint8_t> out;
+
+            void compress (const std::string& filename) {
+              z_stream zs;
+              memset (&zs, 0, sizeof (z_stream));
+              if (deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                throw Exception ("error initialising compression for file \"" + filename + "\"");
+
+              const size_t bound = deflateBound (&zs, in_size);
+              out.resize (GZ_BLOCK_HEADER_SIZE + bound + GZ_BLOCK_TRAILER_SIZE);
+              zs.next_in = const_cast<Bytef*> (in);
+              zs.avail_in = in_size;
+              zs.next_out = &out[GZ_BLOCK_HEADER_SIZE];
+              zs.avail_out = bound;
+              const int status = deflate (&zs, Z_FINISH);
+              const size_t compressed_size = bound - zs.avail_out;
+              deflateEnd (&zs);
+              if (status != Z_STREAM_END)
+                throw Exception ("error compressing data for file \"" + filename + "\"");
+
+              const size_t member_size = GZ_BLOCK_HEADER_SIZE + compressed_size + GZ_BLOCK_TRAILER_SIZE;
+              put_header (&out[0], member_size, in_size);
+              put32 (&out[GZ_BLOCK_HEADER_SIZE + compressed_size], crc32 (crc32 (0, NULL, 0), in, in_size));
+              put32 (&out[GZ_BLOCK_HEADER_SIZE + compressed_size + 4], in_size);
+              out.resize (member_size);
+            }
+        };
+
+
+
+        class Compressor
+        {
+          public:
+            Compressor (std::vector<Block>& blocks, Shared& shared, const std::string& filename) :
+              blocks (blocks), shared (shared), filename (filename) { }
+
+            void execute () {
+              size_t n;
+              while (shared.get_job (n)) {
+                try {
+                  blocks[n].compress (filename);
+                }
+                catch (Exception& E) {
+                  shared.set_error (E);
+                  return;
+                }
+              }
+            }
+
+          private:
+            std::vector<Block>& blocks;
+            Shared& shared;
+            const std::string& filename;
+        };
+
+
+
+
+        class Member
+        {
+          public:
+            Member (int64_t file_offset, size_t member_size, int64_t data_offset, size_t data_size) :
+              offset (file_offset), size (member_size), data_offset (data_offset), data_size (data_size) { }
+            int64_t offset;
+            size_t size;
+            int64_t data_offset;
+            size_t data_size;
+        };
+
+
+
+        class Decompressor
+        {
+          public:
+            Decompressor (const std::vector<Member>& members, Shared& shared, int fd, const std::string& filename,
+                int64_t offset, uint8_t* data, size_t size) :
+              members (members), shared (shared), fd (fd), filename (filename),
+              offset (offset), data (data), size (size) { }
+
+            void execute () {
+              size_t n;
+              while (shared.get_job (n)) {
+                try {
+                  decompress (members[n]);
+                  shared.done();
+                }
+                catch (Exception& E) {
+                  shared.set_error (E);
+                  return;
+                }
+              }
+            }
+
+          private:
+            const std::vector<Member>& members;
+            Shared& shared;
+            const int fd;
+            const std::string& filename;
+            const int64_t offset;
+            uint8_t* const data;
+            const size_t size;
+            std::vector<uint8_t> in, out;
+
+            void decompress (const Member& M) {
+              in.resize (M.size);
+              if (pread (fd, &in[0], M.size, M.offset) != ssize_t (M.size))
+                throw Exception ("error reading from file \"" + filename + "\": " + strerror (errno));
+              out.resize (M.data_size);
+
+              z_stream zs;
+              memset (&zs, 0, sizeof (z_stream));
+              if (inflateInit2 (&zs, -MAX_WBITS) != Z_OK)
+                throw Exception ("error initialising decompression for file \"" + filename + "\"");
+              zs.next_in = &in[GZ_BLOCK_HEADER_SIZE];
+              zs.avail_in = M.size - GZ_BLOCK_HEADER_SIZE - GZ_BLOCK_TRAILER_SIZE;
+              zs.next_out = M.data_size ? &out[0] : NULL;
+              zs.avail_out = M.data_size;
+              const int status = inflate (&zs, Z_FINISH);
+              inflateEnd (&zs);
+
+              const uint8_t* trailer = &in[M.size - GZ_BLOCK_TRAILER_SIZE];
+              if (status != Z_STREAM_END || zs.avail_out ||
+                  get32 (trailer) != crc32 (crc32 (0, NULL, 0), M.data_size ? &out[0] : NULL, M.data_size) ||
+                  get32 (trailer+4) != M.data_size)
+                throw Exception ("error uncompressing file \"" + filename + "\": data are corrupted");
+
+              // copy the part of this member that overlaps the requested range:
+              const int64_t from = std::max (M.data_offset, offset);
+              const int64_t to = std::min (M.data_offset + int64_t (M.data_size), offset + int64_t (size));
+              if (to > from)
+                memcpy (data + (from - offset), &out[from - M.data_offset], to - from);
+            }
+        };
+
+      }
+
+
+
+
+
+      void write (const std::string& filename,
+          const uint8_t* lead_in, size_t lead_in_size,
+          const uint8_t* data, size_t data_size,
+          ProgressBar* progress)
+      {
+        std::ofstream out (filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out)
+          throw Exception ("error opening file \"" + filename + "\" for writing: " + strerror (errno));
+
+        if (lead_in_size) {
+          Block header (lead_in, lead_in_size);
+          header.compress (filename);
+          out.write (reinterpret_cast<const char*> (&header.out[0]), header.out.size());
+        }
+
+        // compress in batches to keep the memory overhead bounded:
+        const size_t num_blocks = (data_size + MRTRIX_GZ_BLOCK_SIZE - 1) / MRTRIX_GZ_BLOCK_SIZE;
+        const size_t batch_size = 4 * std::max (Thread::number_of_threads(), size_t (1));
+
+        for (size_t first = 0; first < num_blocks; first += batch_size) {
+          const size_t last = std::min (first + batch_size, num_blocks);
+          std::vector<Block> blocks;
+          for (size_t n = first; n < last; ++n)
+            blocks.push_back (Block (data + n*MRTRIX_GZ_BLOCK_SIZE,
+                  std::min (size_t (MRTRIX_GZ_BLOCK_SIZE), data_size - n*MRTRIX_GZ_BLOCK_SIZE)));
+
+          Shared shared (blocks.size(), NULL);
+          Compressor compressor (blocks, shared, filename);
+          run_jobs (compressor);
+          shared.check();
+
+          for (size_t n = 0; n < blocks.size(); ++n) {
+            out.write (reinterpret_cast<const char*> (&blocks[n].out[0]), blocks[n].out.size());
+            if (progress)
+              ++(*progress);
+          }
+          if (!out)
+            throw Exception ("error writing to file \"" + filename + "\": " + strerror (errno));
+        }
+      }
+
+
+
+
+
+      bool read (const std::string& filename,
+          int64_t offset, uint8_t* data, size_t size,
+          ProgressBar* progress)
+      {
+        // the file may still be being written in the background:
+        WriteBehind::finish();
+
+        const int fd = open (filename.c_str(), O_RDONLY);
+        if (fd < 0)
+          throw Exception ("error opening file \"" + filename + "\": " + strerror (errno));
+
+        struct stat sbuf;
+        if (fstat (fd, &sbuf)) {
+          close (fd);
+          throw Exception ("cannot stat file \"" + filename + "\": " + strerror (errno));
+        }
+
+        // locate the members that overlap the requested range, by hopping
+        // from one member header to the next:
+        std::vector<Member> members;
+        int64_t file_offset = 0, data_offset = 0;
+        while (file_offset < sbuf.st_size && data_offset < offset + int64_t (size)) {
+          uint8_t header [GZ_BLOCK_HEADER_SIZE];
+          if (pread (fd, header, GZ_BLOCK_HEADER_SIZE, file_offset) != GZ_BLOCK_HEADER_SIZE || !is_block_header (header)) {
+            close (fd);
+            return false;
+          }
+          const size_t member_size = get32 (header+16);
+          const size_t member_data_size = get32 (header+20);
+          if (member_size < GZ_BLOCK_HEADER_SIZE + GZ_BLOCK_TRAILER_SIZE || file_offset + int64_t (member_size) > sbuf.st_size) {
+            close (fd);
+            return false;
+          }
+          if (data_offset + int64_t (member_data_size) > offset)
+            members.push_back (Member (file_offset, member_size, data_offset, member_data_size));
+          file_offset += member_size;
+          data_offset += member_data_size;
+        }
+
+        if (data_offset < offset + int64_t (size)) {
+          close (fd);
+          throw Exception ("unexpected end of file in \"" + filename + "\"");
+        }
+
+        Shared shared (members.size(), progress);
+        Decompressor decompressor (members, shared, fd, filename, offset, data, size);
+        run_jobs (decompressor);
+        close (fd);
+        shared.check();
+        return true;
+      }
+
+    }
+  }
+}
+
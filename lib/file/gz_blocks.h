@@ -0,0 +1,80 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __file_gz_blocks_h__
+#define __file_gz_blocks_h__
+
+#include <string>
+
+#include "types.h"
+
+// the amount of uncompressed data stored in each gzip member
+#define MRTRIX_GZ_BLOCK_SIZE 1048576
+
+namespace MR
+{
+  class ProgressBar;
+
+  namespace File
+  {
+
+    //! functions to read & write gzip files as sequences of independent blocks
+    /*! These functions allow gzip files to be compressed and uncompressed
+     * using multiple threads. This is achieved by storing the data as a
+     * concatenation of independent gzip members, each holding
+     * MRTRIX_GZ_BLOCK_SIZE bytes of uncompressed data (in the same spirit as
+     * the BGZF format or pigz). The resulting files are still valid gzip
+     * files, and can be read by any standard gzip implementation (including
+     * File::GZ).
+     *
+     * To allow the members to be located without first decompressing the
+     * whole file, the header of each member includes an extra field (with
+     * subfield identifier 'M','R') holding the total size of the member, and
+     * the size of its uncompressed data. Standard gzip readers ignore this
+     * field. */
+    namespace GZBlocks
+    {
+
+      //! write \a lead_in followed by \a data to a new gzip file
+      /*! The data are compressed in blocks, in parallel. The \a lead_in data
+       * (typically the image header) are stored in their own member. */
+      void write (const std::string& filename,
+          const uint8_t* lead_in, size_t lead_in_size,
+          const uint8_t* data, size_t data_size,
+          ProgressBar* progress = NULL);
+
+      //! read \a size bytes of uncompressed data starting at \a offset
+      /*! The blocks are uncompressed in parallel. This will return false
+       * (without modifying \a data) if the file was not written by
+       * GZBlocks::write(), in which case the data need to be read serially
+       * using File::GZ. */
+      bool read (const std::string& filename,
+          int64_t offset, uint8_t* data, size_t size,
+          ProgressBar* progress = NULL);
+
+    }
+
+  }
+}
+
+#endif
+
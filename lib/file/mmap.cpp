@@ -30,10 +30,19 @@
 #include <sys/mman.h>
 #endif
 
+#ifdef __linux__
+#include <sys/vfs.h>
+#define TMPFS_MAGIC 0x01021994
+#define NFS_SUPER_MAGIC 0x6969
+#define SMB_SUPER_MAGIC 0x517B
+#define CIFS_MAGIC_NUMBER 0xFF534D42
+#endif
+
 #include "file/ofstream.h"
 #include "file/path.h"
 #include "file/mmap.h"
 #include "file/config.h"
+#include "file/write_behind.h"
 
 #include "debug.h"
 
@@ -42,10 +51,111 @@ namespace MR
   namespace File
   {
 
-    MMap::MMap (const Entry& entry, bool readwrite, bool preload, int64_t mapped_size) :
+    //! \cond skip
+    namespace
+    {
+      // whether a file opened read-write can be mapped shared, rather than
+      // via a RAM buffer written back when closed:
+      inline bool __map_shared (const std::string& filename)
+      {
+#ifdef MRTRIX_WINDOWS
+        return false;
+#else
+# ifdef __linux__
+        struct statfs fsbuf;
+        if (!statfs (filename.c_str(), &fsbuf)) {
+          // nothing to be gained from a RAM buffer for files already held
+          // in memory (e.g. in /dev/shm):
+          if (fsbuf.f_type == TMPFS_MAGIC)
+            return true;
+          // writing via shared mappings is unreliable and often very slow
+          // on network filesystems:
+          if (uint32_t (fsbuf.f_type) == NFS_SUPER_MAGIC || uint32_t (fsbuf.f_type) == SMB_SUPER_MAGIC ||
+              uint32_t (fsbuf.f_type) == CIFS_MAGIC_NUMBER)
+            return false;
+        }
+# endif
+        //CONF option: MapReadWriteShared
+        //CONF default: 1 (true)
+        //CONF whether files opened read-write (e.g. images being modified
+        //CONF in place) should be memory-mapped directly, so that only the
+        //CONF pages actually modified are written back. If false, the
+        //CONF contents of the file are instead loaded into RAM, and written
+        //CONF back in their entirety when the file is closed. Files on
+        //CONF network filesystems (NFS, SMB/CIFS) are always handled via RAM.
+        return File::Config::get_bool ("MapReadWriteShared", true);
+#endif
+      }
+
+
+
+#ifndef MRTRIX_WINDOWS
+      // write back the modified pages of a read-write mapping, and unmap it:
+      class Unmap : public WriteBehind::Job
+      {
+        public:
+          Unmap (const std::string& filename, int fd, uint8_t* address, int64_t size) :
+            name (filename), fd (fd), addr (address), size (size) { }
+
+          virtual void execute () {
+            // only those pages actually modified are written back:
+            if (msync (addr, size, MS_SYNC))
+              WARN ("error writing back contents of file \"" + name + "\": " + strerror (errno));
+            if (munmap (addr, size))
+              WARN ("error unmapping file \"" + name + "\": " + strerror (errno));
+            close (fd);
+          }
+
+        protected:
+          const std::string name;
+          const int fd;
+          uint8_t* const addr;
+          const int64_t size;
+      };
+#endif
+
+
+
+      // write back the contents of a RAM buffer used in place of a mapping:
+      class WriteBack : public WriteBehind::Job
+      {
+        public:
+          WriteBack (const std::string& filename, int64_t offset, uint8_t* data, int64_t size) :
+            name (filename), start (offset), data (data), size (size) { }
+          ~WriteBack () {
+            delete [] data;
+          }
+
+          virtual void execute () {
+            INFO ("writing back contents of mapped file \"" + name + "\"...");
+            File::OFStream out (name, std::ios::in | std::ios::out | std::ios::binary);
+            out.seekp (start, out.beg);
+            out.write ((char*) data, size);
+            if (!out.good())
+              throw Exception ("error writing back contents of file \"" + name + "\": " + strerror(errno));
+          }
+
+        protected:
+          const std::string name;
+          const int64_t start;
+          uint8_t* const data;
+          const int64_t size;
+      };
+
+    }
+    //! \endcond
+
+
+
+    MMap::MMap (const Entry& entry, bool readwrite, bool preload, int64_t mapped_size, Access access) :
       Entry (entry), addr (NULL), first (NULL), msize (mapped_size), readwrite (readwrite)
     {
-      DEBUG (std::string (readwrite ? "creating RAM buffer for" : "memory-mapping" ) + " file \"" + Entry::name + "\"...");
+      // existing contents may still be being written in the background:
+      if (!readwrite || preload)
+        WriteBehind::finish();
+
+      const bool shared = readwrite && __map_shared (Entry::name);
+      DEBUG (std::string (readwrite && !shared ? "creating RAM buffer for" : "memory-mapping" ) + " file \"" + Entry::name + "\"...");
 
       struct stat sbuf;
       if (stat (Entry::name.c_str(), &sbuf))
@@ -59,7 +169,7 @@ namespace MR
       else if (start + msize > sbuf.st_size) 
         throw Exception ("file \"" + Entry::name + "\" is smaller than expected");
 
-      if (readwrite) {
+      if (readwrite && !shared) {
         try {
           first = new uint8_t [msize];
           if (!first) throw 1;
@@ -82,7 +192,7 @@ namespace MR
       }
       else {
 
-        if ( (fd = open (Entry::name.c_str(), O_RDONLY, 0666)) < 0)
+        if ( (fd = open (Entry::name.c_str(), shared ? O_RDWR : O_RDONLY, 0666)) < 0)
           throw Exception ("error opening file \"" + Entry::name + "\": " + strerror (errno));
 
         try {
@@ -94,9 +204,12 @@ namespace MR
           if (!addr) throw 0;
           CloseHandle (handle);
 #else
+          // files opened read-write are mapped shared, so that modifications
+          // are made directly to the file contents, without any copying:
           addr = static_cast<uint8_t*> (mmap ( (char*) 0, start + msize,
-                PROT_READ, MAP_PRIVATE, fd, 0));
+                shared ? PROT_READ | PROT_WRITE : PROT_READ, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0));
           if (addr == MAP_FAILED) throw 0;
+          advise (access);
 #endif
         }
         catch (...) {
@@ -107,7 +220,7 @@ namespace MR
         first = addr + start;
 
         DEBUG ("file \"" + Entry::name + "\" mapped at " + str ( (void*) addr) + ", size " + str (msize)
-            + " (read-" + (readwrite ? "write" : "only") + ")");
+            + " (read-" + (shared ? "write, shared" : "only") + ")");
       }
     }
 
@@ -122,22 +235,23 @@ namespace MR
         DEBUG ("unmapping file \"" + Entry::name + "\"");
 #ifdef MRTRIX_WINDOWS
         if (!UnmapViewOfFile ( (LPVOID) addr))
+          WARN ("error unmapping file \"" + Entry::name + "\": " + strerror (errno));
+        close (fd);
 #else
-          if (munmap (addr, msize))
-#endif
+        if (readwrite)
+          WriteBehind::submit (new Unmap (Entry::name, fd, addr, start + msize));
+        else {
+          if (munmap (addr, start + msize))
             WARN ("error unmapping file \"" + Entry::name + "\": " + strerror (errno));
-        close (fd);
+          close (fd);
+        }
+#endif
       }
       else {
-        if (readwrite) {
-          INFO ("writing back contents of mapped file \"" + Entry::name + "\"...");
-          File::OFStream out (Entry::name, std::ios::in | std::ios::out | std::ios::binary);
-          out.seekp (start, out.beg);
-          out.write ((char*) first, msize);
-          if (!out.good())
-            throw Exception ("error writing back contents of file \"" + Entry::name + "\": " + strerror(errno));
-        }
-        delete [] first;
+        if (readwrite)
+          WriteBehind::submit (new WriteBack (Entry::name, start, first, msize));
+        else
+          delete [] first;
       }
     }
 
@@ -146,6 +260,21 @@ namespace MR
 
 
 
+    void MMap::advise (Access access) const
+    {
+#ifndef MRTRIX_WINDOWS
+      if (!addr || access == Normal)
+        return;
+      const int advice = access == Sequential ? MADV_SEQUENTIAL : ( access == Random ? MADV_RANDOM : MADV_WILLNEED );
+      if (madvise (addr, start + msize, advice))
+        DEBUG ("madvise() failed for file \"" + Entry::name + "\": " + strerror (errno));
+#endif
+    }
+
+
+
+
+
     bool MMap::changed () const
     {
       assert (fd >= 0);
@@ -38,22 +38,41 @@ namespace MR
     class MMap : protected Entry
     {
       public:
+        //! hints as to how the mapped data will be accessed
+        enum Access {
+          Normal,     /**< no particular access pattern */
+          Sequential, /**< accessed in order, from start to end */
+          Random,     /**< accessed in no particular order */
+          WillNeed    /**< all of the data will be needed soon */
+        };
+
         //! create a new memory-mapping to file in \a entry
         /*! map file in \a entry at the offset in \a entry. By default, the
-         * file will be mapped read-only. If \a readwrite is set to true, a
-         * write-back RAM buffer will be allocated to store the contents of the
-         * file, and written back when the constructor is invoked. 
+         * file will be mapped read-only. If \a readwrite is set to true, the
+         * file is mapped shared, so that its contents are modified in place,
+         * and only the pages actually modified are written back to disk.
+         *
+         * If the MapReadWriteShared config file option is set to false, or
+         * the file resides on a network filesystem (NFS, SMB or CIFS), a
+         * read-write file is instead held in a RAM buffer, which is written
+         * back in its entirety (possibly in the background) when the mapping
+         * is destroyed. In this case only, the contents of the file will by
+         * default be preloaded into the buffer; if the file has just been
+         * created, \a preload can be set to false to skip this step. \a
+         * preload has no effect on shared mappings.
          *
-         * By default, the contents of a file mapped read-write will be
-         * preloaded into the RAM buffer. If the file has just been created, \a
-         * preload can be set to false to prevent preloading its contents into
-         * the buffer. 
+         * Any background writes still pending are completed before the
+         * existing contents of the file are accessed.
          *
          * By default, the whole file is mapped. If \a mapped_size is
          * non-zero, then only the region of size \a mapped_size starting from
-         * the byte offset specified in \a entry will be mapped. 
-         */
-        MMap (const Entry& entry, bool readwrite = false, bool preload = true, int64_t mapped_size = -1);
+         * the byte offset specified in \a entry will be mapped.
+         *
+         * \a access provides a hint to the system as to how the data will be
+         * accessed, allowing it to adjust its read-ahead and caching
+         * strategy accordingly. This has no effect for files held in a RAM
+         * buffer. */
+        MMap (const Entry& entry, bool readwrite = false, bool preload = true, int64_t mapped_size = -1, Access access = Normal);
         ~MMap ();
 
         std::string name () const {
@@ -74,6 +93,9 @@ namespace MR
         }
         bool changed () const;
 
+        //! change the hint as to how the mapped data will be accessed
+        void advise (Access access) const;
+
         friend std::ostream& operator<< (std::ostream& stream, const MMap& m) {
           stream << "File::MMap { " << m.name() << " [" << m.fd << "], size: "
                  << m.size() << ", mapped " << (m.readwrite ? "RW" : "RO")
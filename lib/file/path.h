@@ -29,6 +29,7 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
 #include <cerrno>
 #include <unistd.h>
 
@@ -77,6 +78,21 @@ namespace MR
     }
 
 
+    inline bool is_absolute (const std::string& path)
+    {
+      if (path.empty())
+        return false;
+      if (strchr (PATH_SEPARATOR, path[0]))
+        return true;
+#ifdef MRTRIX_WINDOWS
+      // drive letter prefix, e.g. "C:\\" or "C:/":
+      if (path.size() > 2 && isalpha (path[0]) && path[1] == ':' && strchr (PATH_SEPARATOR, path[2]))
+        return true;
+#endif
+      return false;
+    }
+
+
     inline bool exists (const std::string& path)
     {
       struct stat buf;
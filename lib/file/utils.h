@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "app.h"
@@ -62,6 +63,32 @@ namespace MR
         return __tmpfile_prefix;
       }
 
+
+      inline std::string __shared_memory_dir () {
+        //CONF option: PipeInSharedMemory
+        //CONF default: 1 (true)
+        //CONF whether images piped between commands should be held in
+        //CONF shared memory (see SharedMemoryDir), rather than in a
+        //CONF temporary file in TmpFileDir.
+        if (!File::Config::get_bool ("PipeInSharedMemory", true))
+          return tmpfile_dir();
+        //CONF option: SharedMemoryDir
+        //CONF default: /dev/shm
+        //CONF the folder used to hold images piped between commands. This
+        //CONF should reside on a memory-backed filesystem, so that the data
+        //CONF are passed between commands without any disk I/O. If it does
+        //CONF not exist or is not writable, TmpFileDir is used instead.
+        const std::string folder = File::Config::get ("SharedMemoryDir", "/dev/shm");
+        if (Path::is_dir (folder) && !access (folder.c_str(), W_OK))
+          return folder;
+        return tmpfile_dir();
+      }
+
+      const std::string& shared_memory_dir () {
+        static const std::string __shm_dir = __shared_memory_dir();
+        return __shm_dir;
+      }
+
     }
 
 
@@ -115,11 +142,15 @@ namespace MR
 
 
 
-    inline std::string create_tempfile (int64_t size = 0, const char* suffix = NULL)
+    //! create a new temporary file
+    /*! the file will be created in the folder specified by the TmpFileDir
+     * config file entry, or in shared memory if \a in_memory is true (see
+     * the SharedMemoryDir config file entry). */
+    inline std::string create_tempfile (int64_t size = 0, const char* suffix = NULL, bool in_memory = false)
     {
       DEBUG ("creating temporary file of size " + str (size));
 
-      std::string filename (Path::join (tmpfile_dir(), tmpfile_prefix()) + "XXXXXX.");
+      std::string filename (Path::join (in_memory ? shared_memory_dir() : tmpfile_dir(), tmpfile_prefix()) + "XXXXXX.");
       int rand_index = filename.size() - 7;
       if (suffix) filename += suffix;
 
@@ -131,7 +162,7 @@ namespace MR
       } while (fid < 0 && errno == EEXIST);
 
       if (fid < 0)
-        throw Exception (std::string ("error creating temporary file in current working directory: ") + strerror (errno));
+        throw Exception ("error creating temporary file \"" + filename + "\": " + strerror (errno));
 
 
 
@@ -0,0 +1,195 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <deque>
+
+#include "app.h"
+#include "file/config.h"
+#include "file/write_behind.h"
+#include "thread/condition.h"
+#include "thread/pool.h"
+
+namespace MR
+{
+  namespace File
+  {
+
+    //! \cond skip
+    namespace
+    {
+
+      // runs the queued jobs in order, until none are left:
+      class Drain : public Thread::Pool::Task
+      {
+        public:
+          Drain () : completed (mutex), running (false), submitted (0), done (0) { }
+
+          Thread::Mutex mutex;
+          Thread::Cond completed;
+          std::deque<WriteBehind::Job*> jobs;
+          bool running;
+          size_t submitted, done;
+          std::string error;
+
+          virtual void run () {
+            while (true) {
+              WriteBehind::Job* job;
+              {
+                Thread::Mutex::Lock lock (mutex);
+                if (jobs.empty()) {
+                  running = false;
+                  return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+              }
+
+              try {
+                job->execute();
+              }
+              catch (Exception& E) {
+                Thread::Mutex::Lock lock (mutex);
+                if (error.empty())
+                  error = E.description.size() ? E.description.back() : "unknown error";
+              }
+              delete job;
+
+              Thread::Mutex::Lock lock (mutex);
+              ++done;
+              completed.broadcast();
+            }
+          }
+
+          // report any error, once:
+          void check () {
+            if (error.size()) {
+              const std::string message (error);
+              error.clear();
+              throw Exception ("error writing output data: " + message);
+            }
+          }
+      };
+
+      Thread::Mutex __drain_mutex;
+
+      // deliberately never destroyed, as for the Thread::Pool:
+      Drain* __drain = NULL;
+
+      Drain& get_drain ()
+      {
+        Thread::Mutex::Lock lock (__drain_mutex);
+        if (!__drain)
+          __drain = new Drain;
+        return *__drain;
+      }
+
+      // NULL if no jobs have ever been submitted:
+      Drain* existing_drain ()
+      {
+        Thread::Mutex::Lock lock (__drain_mutex);
+        return __drain;
+      }
+
+    }
+    //! \endcond
+
+
+
+
+    bool WriteBehind::enabled ()
+    {
+      //CONF option: WriteBehind
+      //CONF default: 1 (true)
+      //CONF write output image and track data back to file in the
+      //CONF background, so that processing can carry on in the meantime.
+      //CONF Commands wait for any writes still pending before exiting.
+      return File::Config::get_bool ("WriteBehind", true);
+    }
+
+
+
+
+    size_t WriteBehind::submit (Job* job)
+    {
+      if (!enabled()) {
+        try {
+          job->execute();
+        }
+        catch (...) {
+          delete job;
+          throw;
+        }
+        delete job;
+        return 0;
+      }
+
+      Drain& drain (get_drain());
+      size_t ticket;
+      bool start;
+      {
+        Thread::Mutex::Lock lock (drain.mutex);
+        drain.jobs.push_back (job);
+        ticket = ++drain.submitted;
+        start = !drain.running;
+        drain.running = true;
+      }
+
+      if (start)
+        Thread::Pool::get().submit (std::vector<Thread::Pool::Task*> (1, &drain));
+      return ticket;
+    }
+
+
+
+
+    void WriteBehind::wait (size_t ticket)
+    {
+      Drain* drain = existing_drain();
+      if (!drain)
+        return;
+      Thread::Mutex::Lock lock (drain->mutex);
+      if (drain->done < ticket)
+        DEBUG ("waiting for " + str (ticket - drain->done) + " pending write(s)...");
+      while (drain->done < ticket)
+        drain->completed.wait();
+      drain->check();
+    }
+
+
+
+
+    void WriteBehind::finish ()
+    {
+      Drain* drain = existing_drain();
+      if (!drain)
+        return;
+      size_t ticket;
+      {
+        Thread::Mutex::Lock lock (drain->mutex);
+        ticket = drain->submitted;
+      }
+      wait (ticket);
+    }
+
+  }
+}
+
@@ -0,0 +1,80 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __file_write_behind_h__
+#define __file_write_behind_h__
+
+#include <cstddef>
+
+namespace MR
+{
+  namespace File
+  {
+
+    //! a background service to complete writes to output files
+    /*! Output data held in RAM (or in read-write memory-mapped files) are
+     * normally written back when the corresponding object is destroyed,
+     * blocking the calling thread until the data are on disk. These writes
+     * can instead be handed over to this service as a WriteBehind::Job, to
+     * be performed in the background on one of the workers of the
+     * Thread::Pool while processing carries on.
+     *
+     * Jobs are performed one at a time, in order of submission, so that
+     * successive writes to the same file are applied in order. Any error
+     * is held until the next call to wait() or finish(), and reported then.
+     * The standard main() (see command.h) calls finish() once the command
+     * has run, so that the process only waits for the writes still pending
+     * at that point.
+     *
+     * Write-behind can be disabled using the WriteBehind config file option,
+     * in which case jobs are performed as soon as they are submitted. */
+    class WriteBehind
+    {
+      public:
+        //! a write to be performed in the background
+        class Job
+        {
+          public:
+            virtual ~Job () { }
+            //! perform the write, throwing an Exception on error
+            virtual void execute () = 0;
+        };
+
+        //! queue \a job for execution, taking ownership of it
+        /*! returns an identifier for the job that can be passed to wait(). */
+        static size_t submit (Job* job);
+
+        //! wait until job \a ticket and all those before it have completed
+        static void wait (size_t ticket);
+
+        //! wait until all jobs submitted so far have completed
+        static void finish ();
+
+        //! whether jobs are performed in the background
+        static bool enabled ();
+    };
+
+  }
+}
+
+#endif
+
@@ -139,10 +139,33 @@ namespace MR
       // conversion between non-integer real & complex types:
       GET_PUT_FUNC_BO_COMPLEX(float32,no_round);
       GET_PUT_FUNC_BO_COMPLEX(float64,no_round);
+
+
+
+      // conversion of contiguous runs of values. With the storage type and
+      // byte order resolved at compile-time, the per-value functions above
+      // are inlined, allowing the compiler to vectorise these loops:
+#define GET_PUT_BLOCK_FUNC(suffix) \
+      template <typename value_type, typename S> \
+        void __get_block##suffix (const void* data, size_t i, value_type* values, size_t count) { \
+          for (size_t n = 0; n < count; ++n) \
+            values[n] = __get##suffix<value_type,S> (data, i+n); \
+        } \
+      template <typename value_type, typename S> \
+        void __put_block##suffix (const value_type* values, void* data, size_t i, size_t count) { \
+          for (size_t n = 0; n < count; ++n) \
+            __put##suffix<value_type,S> (values[n], data, i+n); \
+        }
+
+      GET_PUT_BLOCK_FUNC();
+      GET_PUT_BLOCK_FUNC(LE);
+      GET_PUT_BLOCK_FUNC(BE);
     }
 
     // \endcond
 
+#define MRTRIX_BUFFER_BLOCK_SIZE 1024
+
 
 
 
@@ -201,19 +224,69 @@ namespace MR
 
         value_type get_value (size_t offset) const {
           ssize_t nseg (offset / handler_->segment_size());
-          return scale_from_storage (get_func (handler_->segment (nseg), offset - nseg*handler_->segment_size()));
+          value_type val = scale_from_storage (get_func (handler_->segment (nseg), offset - nseg*handler_->segment_size()));
+          handler_->release (nseg);
+          return val;
         }
 
         void set_value (size_t offset, value_type val) {
           ssize_t nseg (offset / handler_->segment_size());
-          put_func (scale_to_storage (val), handler_->segment (nseg), offset - nseg*handler_->segment_size());
+          put_func (scale_to_storage (val), handler_->segment_for_write (nseg), offset - nseg*handler_->segment_size());
+          handler_->release (nseg);
+        }
+
+        //! read the \a count values stored contiguously from \a offset onwards
+        /*! this is equivalent to invoking get_value() for each offset in
+         * turn, but performs the conversion from the storage type in bulk. */
+        void get_values (size_t offset, value_type* values, size_t count) const {
+          const bool scaled = intensity_offset() != 0.0 || intensity_scale() != 1.0;
+          while (count) {
+            const size_t nseg (offset / handler_->segment_size());
+            const size_t index (offset - nseg*handler_->segment_size());
+            const size_t num (std::min (count, handler_->segment_size() - index));
+            get_block_func (handler_->segment (nseg), index, values, num);
+            handler_->release (nseg);
+            if (scaled)
+              for (size_t n = 0; n < num; ++n)
+                values[n] = scale_from_storage (values[n]);
+            offset += num;
+            values += num;
+            count -= num;
+          }
+        }
+
+        //! write \a count values to be stored contiguously from \a offset onwards
+        /*! this is equivalent to invoking set_value() for each offset in
+         * turn, but performs the conversion to the storage type in bulk. */
+        void set_values (size_t offset, const value_type* values, size_t count) {
+          const bool scaled = intensity_offset() != 0.0 || intensity_scale() != 1.0;
+          value_type scaled_values [MRTRIX_BUFFER_BLOCK_SIZE];
+          while (count) {
+            const size_t nseg (offset / handler_->segment_size());
+            const size_t index (offset - nseg*handler_->segment_size());
+            size_t num (std::min (count, handler_->segment_size() - index));
+            const value_type* block = values;
+            if (scaled) {
+              num = std::min (num, size_t (MRTRIX_BUFFER_BLOCK_SIZE));
+              for (size_t n = 0; n < num; ++n)
+                scaled_values[n] = scale_to_storage (values[n]);
+              block = scaled_values;
+            }
+            put_block_func (block, handler_->segment_for_write (nseg), index, num);
+            handler_->release (nseg);
+            offset += num;
+            values += num;
+            count -= num;
+          }
         }
 
         friend std::ostream& operator<< (std::ostream& stream, const Buffer& V) {
           stream << "data for image \"" << V.name() << "\": " + str (Image::voxel_count (V))
             + " voxels in " + V.datatype().specifier() + " format, stored in " + str (V.handler_->nsegments())
-            + " segments of size " + str (V.handler_->segment_size())
-            + ", at addresses [ ";
+            + " segments of size " + str (V.handler_->segment_size());
+          if (V.handler_->is_paged())
+            return stream << ", paged on demand";
+          stream << ", at addresses [ ";
           for (size_t n = 0; n < V.handler_->nsegments(); ++n)
             stream << str ((void*) V.handler_->segment(n)) << " ";
           stream << "]";
@@ -226,100 +299,148 @@ namespace MR
 
         value_type (*get_func) (const void* data, size_t i);
         void (*put_func) (value_type val, void* data, size_t i);
+        void (*get_block_func) (const void* data, size_t i, value_type* values, size_t count);
+        void (*put_block_func) (const value_type* values, void* data, size_t i, size_t count);
 
         void set_get_put_functions () {
           switch (datatype() ()) {
             case DataType::Bit:
               get_func = &__get<value_type,bool>;
               put_func = &__put<value_type,bool>;
+              get_block_func = &__get_block<value_type,bool>;
+              put_block_func = &__put_block<value_type,bool>;
               return;
             case DataType::Int8:
               get_func = &__get<value_type,int8_t>;
               put_func = &__put<value_type,int8_t>;
+              get_block_func = &__get_block<value_type,int8_t>;
+              put_block_func = &__put_block<value_type,int8_t>;
               return;
             case DataType::UInt8:
               get_func = &__get<value_type,uint8_t>;
               put_func = &__put<value_type,uint8_t>;
+              get_block_func = &__get_block<value_type,uint8_t>;
+              put_block_func = &__put_block<value_type,uint8_t>;
               return;
             case DataType::Int16LE:
               get_func = &__getLE<value_type,int16_t>;
               put_func = &__putLE<value_type,int16_t>;
+              get_block_func = &__get_blockLE<value_type,int16_t>;
+              put_block_func = &__put_blockLE<value_type,int16_t>;
               return;
             case DataType::UInt16LE:
               get_func = &__getLE<value_type,uint16_t>;
               put_func = &__putLE<value_type,uint16_t>;
+              get_block_func = &__get_blockLE<value_type,uint16_t>;
+              put_block_func = &__put_blockLE<value_type,uint16_t>;
               return;
             case DataType::Int16BE:
               get_func = &__getBE<value_type,int16_t>;
               put_func = &__putBE<value_type,int16_t>;
+              get_block_func = &__get_blockBE<value_type,int16_t>;
+              put_block_func = &__put_blockBE<value_type,int16_t>;
               return;
             case DataType::UInt16BE:
               get_func = &__getBE<value_type,uint16_t>;
               put_func = &__putBE<value_type,uint16_t>;
+              get_block_func = &__get_blockBE<value_type,uint16_t>;
+              put_block_func = &__put_blockBE<value_type,uint16_t>;
               return;
             case DataType::Int32LE:
               get_func = &__getLE<value_type,int32_t>;
               put_func = &__putLE<value_type,int32_t>;
+              get_block_func = &__get_blockLE<value_type,int32_t>;
+              put_block_func = &__put_blockLE<value_type,int32_t>;
               return;
             case DataType::UInt32LE:
               get_func = &__getLE<value_type,uint32_t>;
               put_func = &__putLE<value_type,uint32_t>;
+              get_block_func = &__get_blockLE<value_type,uint32_t>;
+              put_block_func = &__put_blockLE<value_type,uint32_t>;
               return;
             case DataType::Int32BE:
               get_func = &__getBE<value_type,int32_t>;
               put_func = &__putBE<value_type,int32_t>;
+              get_block_func = &__get_blockBE<value_type,int32_t>;
+              put_block_func = &__put_blockBE<value_type,int32_t>;
               return;
             case DataType::UInt32BE:
               get_func = &__getBE<value_type,uint32_t>;
               put_func = &__putBE<value_type,uint32_t>;
+              get_block_func = &__get_blockBE<value_type,uint32_t>;
+              put_block_func = &__put_blockBE<value_type,uint32_t>;
               return;
             case DataType::Int64LE:
               get_func = &__getLE<value_type,int64_t>;
               put_func = &__putLE<value_type,int64_t>;
+              get_block_func = &__get_blockLE<value_type,int64_t>;
+              put_block_func = &__put_blockLE<value_type,int64_t>;
               return;
             case DataType::UInt64LE:
               get_func = &__getLE<value_type,uint64_t>;
               put_func = &__putLE<value_type,uint64_t>;
+              get_block_func = &__get_blockLE<value_type,uint64_t>;
+              put_block_func = &__put_blockLE<value_type,uint64_t>;
               return;
             case DataType::Int64BE:
               get_func = &__getBE<value_type,int64_t>;
               put_func = &__putBE<value_type,int64_t>;
+              get_block_func = &__get_blockBE<value_type,int64_t>;
+              put_block_func = &__put_blockBE<value_type,int64_t>;
               return;
             case DataType::UInt64BE:
               get_func = &__getBE<value_type,uint64_t>;
               put_func = &__putBE<value_type,uint64_t>;
+              get_block_func = &__get_blockBE<value_type,uint64_t>;
+              put_block_func = &__put_blockBE<value_type,uint64_t>;
               return;
             case DataType::Float32LE:
               get_func = &__getLE<value_type,float>;
               put_func = &__putLE<value_type,float>;
+              get_block_func = &__get_blockLE<value_type,float>;
+              put_block_func = &__put_blockLE<value_type,float>;
               return;
             case DataType::Float32BE:
               get_func = &__getBE<value_type,float>;
               put_func = &__putBE<value_type,float>;
+              get_block_func = &__get_blockBE<value_type,float>;
+              put_block_func = &__put_blockBE<value_type,float>;
               return;
             case DataType::Float64LE:
               get_func = &__getLE<value_type,double>;
               put_func = &__putLE<value_type,double>;
+              get_block_func = &__get_blockLE<value_type,double>;
+              put_block_func = &__put_blockLE<value_type,double>;
               return;
             case DataType::Float64BE:
               get_func = &__getBE<value_type,double>;
               put_func = &__putBE<value_type,double>;
+              get_block_func = &__get_blockBE<value_type,double>;
+              put_block_func = &__put_blockBE<value_type,double>;
               return;
             case DataType::CFloat32LE:
               get_func = &__getLE<value_type,cfloat>;
               put_func = &__putLE<value_type,cfloat>;
+              get_block_func = &__get_blockLE<value_type,cfloat>;
+              put_block_func = &__put_blockLE<value_type,cfloat>;
               return;
             case DataType::CFloat32BE:
               get_func = &__getBE<value_type,cfloat>;
               put_func = &__putBE<value_type,cfloat>;
+              get_block_func = &__get_blockBE<value_type,cfloat>;
+              put_block_func = &__put_blockBE<value_type,cfloat>;
               return;
             case DataType::CFloat64LE:
               get_func = &__getLE<value_type,cdouble>;
               put_func = &__putLE<value_type,cdouble>;
+              get_block_func = &__get_blockLE<value_type,cdouble>;
+              put_block_func = &__put_blockLE<value_type,cdouble>;
               return;
             case DataType::CFloat64BE:
               get_func = &__getBE<value_type,cdouble>;
               put_func = &__putBE<value_type,cdouble>;
+              get_block_func = &__get_blockBE<value_type,cdouble>;
+              put_block_func = &__put_blockBE<value_type,cdouble>;
               return;
             default:
               throw Exception ("invalid data type in image header");
@@ -0,0 +1,191 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __image_buffer_direct_h__
+#define __image_buffer_direct_h__
+
+#include "image/buffer.h"
+#include "image/voxel.h"
+
+namespace MR
+{
+  namespace Image
+  {
+
+    //! \cond skip
+    namespace
+    {
+      // access to data stored as StorageType in native byte order:
+      template <typename ValueType, typename StorageType>
+        class __Native {
+          public:
+            static ValueType get (const void* data, size_t i) {
+              return MRTRIX_IS_BIG_ENDIAN ? __getBE<ValueType,StorageType> (data, i) : __getLE<ValueType,StorageType> (data, i);
+            }
+            static void put (ValueType val, void* data, size_t i) {
+              if (MRTRIX_IS_BIG_ENDIAN) __putBE<ValueType,StorageType> (val, data, i);
+              else __putLE<ValueType,StorageType> (val, data, i);
+            }
+        };
+
+      // single-byte types have no byte order:
+#define __NATIVE_SINGLE_BYTE(type) \
+      template <typename ValueType> class __Native<ValueType,type> { \
+        public: \
+          static ValueType get (const void* data, size_t i) { return __get<ValueType,type> (data, i); } \
+          static void put (ValueType val, void* data, size_t i) { __put<ValueType,type> (val, data, i); } \
+      }
+      __NATIVE_SINGLE_BYTE (bool);
+      __NATIVE_SINGLE_BYTE (int8_t);
+      __NATIVE_SINGLE_BYTE (uint8_t);
+#undef __NATIVE_SINGLE_BYTE
+    }
+    //! \endcond
+
+
+
+
+    //! a Buffer specialised at compile-time for data of a given storage type
+    /*! This class provides access to the same data as the Image::Buffer it
+     * is constructed from, but with the conversion between the storage type
+     * and \c value_type resolved at compile-time rather than via the function
+     * pointers used by Image::Buffer. This removes the indirect call and the
+     * segment and scaling arithmetic from every voxel access, allowing the
+     * compiler to inline (and potentially vectorise) the loops using it.
+     *
+     * This is only possible if the data are stored in a single segment in
+     * native byte order as \a StorageType, and require no intensity scaling
+     * (see supported()). There should be no need to use this class directly:
+     * use Image::direct_access() instead, which will select the appropriate
+     * specialisation for the image, or fall back to the generic Image::Buffer
+     * if none applies. */
+    template <typename ValueType, typename StorageType>
+      class BufferDirect : public Buffer<ValueType>
+    {
+      public:
+        BufferDirect (const Buffer<ValueType>& buffer) :
+          Buffer<ValueType> (buffer),
+          data_ (handler_->segment_for_write (0)) {
+            assert (supported (buffer));
+          }
+
+        typedef ValueType value_type;
+        typedef Image::Voxel<BufferDirect> voxel_type;
+
+        value_type get_value (size_t index) const {
+          return __Native<value_type,StorageType>::get (data_, index);
+        }
+
+        void set_value (size_t index, value_type val) {
+          __Native<value_type,StorageType>::put (val, data_, index);
+        }
+
+        //! whether the data in \a buffer can be accessed using this class
+        static bool supported (const Buffer<ValueType>& buffer) {
+          const RefPtr<Handler::Base> handler (buffer.__get_handler());
+          return buffer.datatype() == DataType::from<StorageType>() &&
+            buffer.intensity_offset() == 0.0 && buffer.intensity_scale() == 1.0 &&
+            handler->nsegments() == 1 && !handler->is_paged();
+        }
+
+        friend std::ostream& operator<< (std::ostream& stream, const BufferDirect& V) {
+          stream << "direct access to data for image \"" << V.name() << "\": " + str (Image::voxel_count (V))
+            + " voxels in " + V.datatype().specifier() + " format, stored at address " + str ((void*) V.data_);
+          return stream;
+        }
+
+      protected:
+        uint8_t* data_;
+        using Buffer<ValueType>::handler_;
+
+        template <class Set> BufferDirect& operator= (const Set& H) { assert (0); return *this; }
+    };
+
+
+
+
+    //! \cond skip
+    namespace
+    {
+      template <typename StorageType, typename ValueType, class Functor>
+        inline bool __direct_access (Buffer<ValueType>& buffer, Functor& functor)
+        {
+          if (!BufferDirect<ValueType,StorageType>::supported (buffer))
+            return false;
+          BufferDirect<ValueType,StorageType> direct (buffer);
+          typename BufferDirect<ValueType,StorageType>::voxel_type vox (direct);
+          functor (vox);
+          return true;
+        }
+    }
+    //! \endcond
+
+
+
+    //! invoke \a functor with the most efficient voxel accessor for \a buffer
+    /*! The functor should provide a templated operator() taking a VoxelType
+     * argument by reference. It will be invoked once, with a voxel accessor
+     * based on the Image::BufferDirect specialisation matching the storage
+     * type of the data if possible, or a regular Image::Buffer::voxel_type
+     * otherwise. This allows the dispatch on the data type to happen once
+     * for the whole image, rather than for every voxel access. For example:
+     * \code
+     * class Sum {
+     *   public:
+     *     Sum () : sum (0.0) { }
+     *     template <class VoxelType> void operator() (VoxelType& vox) {
+     *       Image::LoopInOrder loop (vox);
+     *       for (loop.start (vox); loop.ok(); loop.next (vox))
+     *         sum += vox.value();
+     *     }
+     *     double sum;
+     * };
+     *
+     * Image::Buffer<float> buffer (argument[0]);
+     * Sum sum;
+     * Image::direct_access (buffer, sum);
+     * \endcode
+     * \note since this will instantiate the functor for each supported
+     * storage type, this is best reserved for the performance-critical
+     * sections of the code. */
+    template <typename ValueType, class Functor>
+      inline void direct_access (Buffer<ValueType>& buffer, Functor& functor)
+      {
+        if (__direct_access<float> (buffer, functor)) return;
+        if (__direct_access<double> (buffer, functor)) return;
+        if (__direct_access<uint8_t> (buffer, functor)) return;
+        if (__direct_access<int8_t> (buffer, functor)) return;
+        if (__direct_access<uint16_t> (buffer, functor)) return;
+        if (__direct_access<int16_t> (buffer, functor)) return;
+        if (__direct_access<uint32_t> (buffer, functor)) return;
+        if (__direct_access<int32_t> (buffer, functor)) return;
+        if (__direct_access<bool> (buffer, functor)) return;
+
+        typename Buffer<ValueType>::voxel_type vox (buffer);
+        functor (vox);
+      }
+
+  }
+}
+
+#endif
+
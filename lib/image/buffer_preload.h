@@ -131,7 +131,9 @@ namespace MR
               datatype() == DataType::from<value_type>() &&
               intensity_offset() == 0.0 && intensity_scale() == 1.0) {
             INFO ("data in \"" + name() + "\" already in required format - mapping as-is");
-            data_ = reinterpret_cast<value_type*> (handler_->segment (0));
+            // the data may be modified directly via data_, and the segment
+            // is never released (there is only one, so it won't be evicted):
+            data_ = reinterpret_cast<value_type*> (handler_->segment_for_write (0));
             return;
           }
 
@@ -0,0 +1,167 @@
+/*
+    Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+    Written by agent, 17/10/26.
+
+    This file is part of MRtrix.
+
+    MRtrix is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    MRtrix is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __image_bulk_copy_h__
+#define __image_bulk_copy_h__
+
+#include "image/threaded_loop.h"
+
+// the minimum number of contiguous voxels for bulk conversion to be used:
+#define MRTRIX_BULK_COPY_MIN_RUN 16
+// the maximum number of voxels converted in one go:
+#define MRTRIX_BULK_COPY_MAX_RUN 16384
+
+namespace MR
+{
+  namespace Image
+  {
+
+    template <class BufferType> class Voxel;
+    template <typename ValueType> class Buffer;
+
+    //! \cond skip
+    namespace {
+
+      // copy the runs of contiguous voxels starting at each position in the
+      // outer loop, via a buffer of values in between:
+      template <class VoxelType>
+        class __CopyRuns {
+          public:
+            __CopyRuns (const VoxelType& source, const VoxelType& destination,
+                const std::vector<size_t>& outer_axes, size_t run_length) :
+              in (source), out (destination), axes (outer_axes), values (run_length) { }
+
+            void operator() (const Iterator& pos) {
+              for (size_t n = 0; n < axes.size(); ++n)
+                in[axes[n]] = out[axes[n]] = pos[axes[n]];
+              in.get_values (&values[0], values.size());
+              out.set_values (&values[0], values.size());
+            }
+
+          protected:
+            VoxelType in, out;
+            const std::vector<size_t>& axes;
+            std::vector<typename VoxelType::value_type> values;
+        };
+
+
+
+      template <class InfoType>
+        inline std::vector<size_t> __axes (const InfoType& info, size_t from_axis, size_t to_axis)
+        {
+          std::vector<size_t> axes;
+          for (size_t n = from_axis; n < std::min (to_axis, info.ndim()); ++n)
+            axes.push_back (n);
+          return axes;
+        }
+
+
+      // by default, copies are performed voxel by voxel:
+      template <class InputVoxelType, class OutputVoxelType>
+        inline bool __bulk_copy (InputVoxelType& source, OutputVoxelType& destination,
+            const std::vector<size_t>& axes, const std::string& message, bool threaded)
+        {
+          return false;
+        }
+
+
+      // copies between Image::Buffer objects are performed in bulk for each
+      // run of voxels that is contiguous in both source and destination:
+      template <typename ValueType>
+        inline bool __bulk_copy (Voxel<Buffer<ValueType> >& source, Voxel<Buffer<ValueType> >& destination,
+            const std::vector<size_t>& axes, const std::string& message, bool threaded)
+        {
+          if (axes.empty())
+            return false;
+          for (size_t n = 0; n < axes.size(); ++n)
+            if (axes[n] >= destination.ndim() || source.dim (axes[n]) != destination.dim (axes[n]))
+              return false;
+
+          // axes must be sorted by increasing stride in the source:
+          std::vector<size_t> order (axes);
+          for (size_t i = 1; i < order.size(); ++i)
+            for (size_t j = i; j > 0 && std::abs (source.stride (order[j])) < std::abs (source.stride (order[j-1])); --j)
+              std::swap (order[j], order[j-1]);
+
+          const size_t first = order[0];
+          if (std::abs (source.stride (first)) != 1 || source.stride (first) != destination.stride (first))
+            return false;
+
+          // merge further axes into the run while the data remain contiguous:
+          size_t run_length = source.dim (first);
+          size_t num_run_axes = 1;
+          if (source.stride (first) > 0) {
+            for (; num_run_axes < order.size(); ++num_run_axes) {
+              const size_t axis = order[num_run_axes];
+              if (source.stride (axis) != ssize_t (run_length) || destination.stride (axis) != ssize_t (run_length) ||
+                  run_length * source.dim (axis) > MRTRIX_BULK_COPY_MAX_RUN)
+                break;
+              run_length *= source.dim (axis);
+            }
+          }
+          if (run_length < MRTRIX_BULK_COPY_MIN_RUN)
+            return false;
+
+          const std::vector<size_t> run_axes (order.begin(), order.begin() + num_run_axes);
+          const std::vector<size_t> outer_axes (order.begin() + num_run_axes, order.end());
+
+          // each run starts from the voxel with the lowest offset:
+          for (size_t n = 0; n < run_axes.size(); ++n)
+            source[run_axes[n]] = destination[run_axes[n]] = source.stride (run_axes[n]) < 0 ? source.dim (run_axes[n]) - 1 : 0;
+
+          __CopyRuns<Voxel<Buffer<ValueType> > > copy (source, destination, outer_axes, run_length);
+
+          if (outer_axes.empty()) {
+            Iterator pos (source);
+            copy (pos);
+          }
+          else if (threaded) {
+            if (message.size())
+              ThreadedLoop (message, source, outer_axes, run_axes).run_outer (copy);
+            else
+              ThreadedLoop (source, outer_axes, run_axes).run_outer (copy);
+          }
+          else {
+            Iterator pos (source);
+            if (message.size()) {
+              LoopInOrder loop (outer_axes, message);
+              for (loop.start (pos); loop.ok(); loop.next (pos))
+                copy (pos);
+            }
+            else {
+              LoopInOrder loop (outer_axes);
+              for (loop.start (pos); loop.ok(); loop.next (pos))
+                copy (pos);
+            }
+          }
+          return true;
+        }
+
+    }
+    //! \endcond
+
+  }
+}
+
+#endif
+
+
@@ -25,6 +25,7 @@
 
 #include "debug.h"
 #include "image/loop.h"
+#include "image/bulk_copy.h"
 
 namespace MR
 {
@@ -34,6 +35,8 @@ namespace MR
     template <class InputVoxelType, class OutputVoxelType>
     void copy (InputVoxelType& source, OutputVoxelType& destination, size_t from_axis = 0, size_t to_axis = std::numeric_limits<size_t>::max())
     {
+      if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), std::string(), false))
+        return;
       LoopInOrder loop (source, from_axis, to_axis);
       for (loop.start (source, destination); loop.ok(); loop.next (source, destination))
         destination.value() = source.value();
@@ -52,6 +55,8 @@ namespace MR
     template <class InputVoxelType, class OutputVoxelType>
     void copy_with_progress_message (const std::string& message, InputVoxelType& source, OutputVoxelType& destination, size_t from_axis = 0, size_t to_axis = std::numeric_limits<size_t>::max())
     {
+      if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), message, false))
+        return;
       LoopInOrder loop (source, message, from_axis, to_axis);
       for (loop.start (source, destination); loop.ok(); loop.next (source, destination))
         destination.value() = source.value();
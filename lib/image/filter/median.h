@@ -85,10 +85,12 @@ namespace MR
           template <class InputVoxelType, class OutputVoxelType>
           void operator() (InputVoxelType& in, OutputVoxelType& out) {
               Adapter::Median3D<InputVoxelType> median (in, extent_);
+              // process in tiles so that overlapping neighbourhoods stay in cache:
+              const std::vector<size_t> tile (3, 8);
               if (message.size())
-                threaded_copy_with_progress_message (message, median, out);
+                threaded_copy_tiled_with_progress_message (message, median, out, tile);
               else
-                threaded_copy (median, out);
+                threaded_copy_tiled (median, out, tile);
           }
 
       protected:
@@ -152,7 +152,7 @@ namespace MR
                   out_data = new BufferScratch<float> (input);
                   out = new BufferScratch<float>::voxel_type (*out_data);
                   Adapter::Gaussian1D<BufferScratch<float>::voxel_type > gaussian (*in, stdev[dim], dim, extent[dim]);
-                  threaded_copy (gaussian, *out);
+                  threaded_copy_tiled (gaussian, *out, std::vector<size_t> (3, 8));
                   in_data = out_data;
                   in = out;
                   if (progress)
@@ -37,6 +37,7 @@ namespace MR
       Format::Pipe          pipe_handler;
       Format::MRtrix        mrtrix_handler;
       Format::MRtrix_GZ     mrtrix_gz_handler;
+      Format::MRtrix_Chunked mrtrix_chunked_handler;
       Format::MRI           mri_handler;
       Format::NIfTI         nifti_handler;
       Format::NIfTI_GZ      nifti_gz_handler;
@@ -56,6 +57,7 @@ namespace MR
         &dicom_handler,
         &mrtrix_handler,
         &mrtrix_gz_handler,
+        &mrtrix_chunked_handler,
         &nifti_handler,
         &nifti_gz_handler,
         &analyse_handler,
@@ -73,6 +75,7 @@ namespace MR
         ".mih",
         ".mif",
         ".mif.gz",
+        ".mifc",
         ".img",
         ".nii",
         ".nii.gz",
@@ -58,6 +58,14 @@ namespace MR
 
         read_mrtrix_header (H, kv);
 
+        // virtual images list each of their files explicitly:
+        Header::const_iterator entries = H.find ("file");
+        if (entries != H.end() && entries->second.find ('\n') != std::string::npos) {
+          RefPtr<Handler::Base> handler (new Handler::Default (H));
+          get_mrtrix_file_list (H, "file", handler->files);
+          return handler;
+        }
+
         std::string fname;
         size_t offset;
         get_mrtrix_file_path (H, "file", fname, offset);
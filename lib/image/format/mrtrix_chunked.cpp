@@ -0,0 +1,145 @@
+/*
+    Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+    Written by agent, 17/10/26.
+
+    This file is part of MRtrix.
+
+    MRtrix is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    MRtrix is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "image/stride.h"
+#include "types.h"
+#include "file/config.h"
+#include "file/ofstream.h"
+#include "file/utils.h"
+#include "file/entry.h"
+#include "file/path.h"
+#include "file/key_value.h"
+#include "image/utils.h"
+#include "image/header.h"
+#include "image/handler/chunked.h"
+#include "image/format/list.h"
+#include "image/format/mrtrix_utils.h"
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Format
+    {
+
+
+      // extension is:
+      // mifc: MRtrix Image File, chunked & compressed
+
+      RefPtr<Handler::Base> MRtrix_Chunked::read (Header& H) const
+      {
+        if (!Path::has_suffix (H.name(), ".mifc"))
+          return RefPtr<Handler::Base>();
+
+        File::KeyValue kv (H.name(), "mrtrix image");
+
+        read_mrtrix_header (H, kv);
+
+        std::map<std::string,std::string>::iterator entry = H.find ("chunk_size");
+        if (entry == H.end())
+          throw Exception ("missing \"chunk_size\" entry in chunked image \"" + H.name() + "\"");
+        const size_t chunk_size = to<size_t> (entry->second);
+        H.erase (entry);
+
+        std::string fname;
+        size_t offset;
+        get_mrtrix_file_path (H, "file", fname, offset);
+        if (fname != H.name())
+          throw Exception ("chunked MRtrix format images must have image data within the same file as the header");
+
+        RefPtr<Handler::Base> handler (new Handler::Chunked (H, chunk_size));
+        handler->files.push_back (File::Entry (H.name(), offset));
+
+        return handler;
+      }
+
+
+
+
+
+      bool MRtrix_Chunked::check (Header& H, size_t num_axes) const
+      {
+        if (!Path::has_suffix (H.name(), ".mifc"))
+          return false;
+
+        H.set_ndim (num_axes);
+        for (size_t i = 0; i < H.ndim(); i++)
+          if (H.dim (i) < 1)
+            H.dim(i) = 1;
+
+        return true;
+      }
+
+
+
+
+
+      RefPtr<Handler::Base> MRtrix_Chunked::create (Header& H) const
+      {
+        //CONF option: MRtrixChunkAxes
+        //CONF default: 3
+        //CONF the number of axes spanned by each chunk of images stored in
+        //CONF the chunked MRtrix format (.mifc), taken in order of
+        //CONF increasing stride. The default stores each 3D volume of
+        //CONF the image as a separate chunk.
+        const size_t chunk_axes = std::max (File::Config::get_int ("MRtrixChunkAxes", 3), 1);
+
+        Stride::List strides (Stride::get (H));
+        Stride::sanitise (strides);
+        const std::vector<size_t> axes (Stride::order (strides));
+        size_t chunk_size = 1;
+        for (size_t n = 0; n < std::min (chunk_axes, axes.size()); ++n)
+          chunk_size *= H.dim (axes[n]);
+
+        const size_t nvoxels = Image::voxel_count (H);
+        // chunks of bitwise data must start on a byte boundary:
+        if (H.datatype().bits() == 1 && chunk_size % 8)
+          chunk_size = nvoxels;
+        const size_t num_chunks = (nvoxels + chunk_size - 1) / chunk_size;
+
+        File::OFStream out (H.name(), std::ios::out | std::ios::binary);
+
+        out << "mrtrix image\n";
+        write_mrtrix_header (H, out);
+        out << "chunk_size: " << chunk_size << "\n";
+
+        out << "file: ";
+        int64_t offset = out.tellp() + int64_t(18);
+        offset += ((4 - (offset % 4)) % 4);
+        out << ". " << offset << "\nEND\n";
+
+        out.close();
+
+        // the chunk index is initially empty, so chunks that are never
+        // written will read back as zero:
+        File::resize (H.name(), offset + MRTRIX_CHUNK_INDEX_ENTRY_SIZE * int64_t (num_chunks));
+
+        RefPtr<Handler::Base> handler (new Handler::Chunked (H, chunk_size));
+        handler->files.push_back (File::Entry (H.name(), offset));
+
+        return handler;
+      }
+
+
+    }
+  }
+}
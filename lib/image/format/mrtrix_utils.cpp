@@ -82,6 +82,33 @@ namespace MR
         const std::string path = i->second;
         H.erase (i);
 
+        parse_mrtrix_file_path (H, path, fname, offset);
+      }
+
+
+
+
+      void get_mrtrix_file_list (Header& H, const std::string& flag, std::vector<File::Entry>& entries)
+      {
+        Header::iterator i = H.find (flag);
+        if (i == H.end())
+          throw Exception ("missing \"" + flag + "\" specification for MRtrix image \"" + H.name() + "\"");
+        const std::vector<std::string> paths = split (i->second, "\n");
+        H.erase (i);
+
+        std::string fname;
+        size_t offset;
+        for (size_t n = 0; n < paths.size(); ++n) {
+          parse_mrtrix_file_path (H, paths[n], fname, offset);
+          entries.push_back (File::Entry (fname, offset));
+        }
+      }
+
+
+
+
+      void parse_mrtrix_file_path (const Header& H, const std::string& path, std::string& fname, size_t& offset)
+      {
         std::istringstream file_stream (path);
         file_stream >> fname;
         offset = 0;
@@ -99,10 +126,10 @@ namespace MR
           if (offset == 0)
             throw Exception ("invalid offset specified for embedded MRtrix image \"" + H.name() + "\"");
           fname = H.name();
-        } else {
+        } 
+        else if (fname.size() && !Path::is_absolute (fname)) {
           fname = Path::join (Path::dirname (H.name()), fname);
         }
-
       }
 
 
@@ -27,6 +27,7 @@
 #include "file/key_value.h"
 #include "file/ofstream.h"
 #include "file/path.h"
+#include "file/entry.h"
 #include "image/header.h"
 #include "image/stride.h"
 
@@ -55,6 +56,13 @@ namespace MR
       //   into new images created using this header
       void get_mrtrix_file_path (Header&, const std::string&, std::string&, size_t&);
 
+      // As above, for images whose data are held in several files, listed one per
+      // line (as used for virtual images - see Image::Virtual)
+      void get_mrtrix_file_list (Header&, const std::string&, std::vector<File::Entry>&);
+
+      // Parse the file name and offset in a single 'file' entry
+      void parse_mrtrix_file_path (const Header&, const std::string&, std::string&, size_t&);
+
       // Write generic image header information to a stream -
       //   this could be an ofstream in the case of .mif, or a stringstream in the case of .mif.gz
       template <class StreamType>
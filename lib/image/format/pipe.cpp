@@ -65,7 +65,9 @@ namespace MR
         if (H.name() != "-")
           return false;
 
-        H.name() = File::create_tempfile (0, "mif");
+        // held in shared memory where possible, so that the data are passed
+        // to the next command without any disk I/O:
+        H.name() = File::create_tempfile (0, "mif", true);
 
         return mrtrix_handler.check (H, num_axes);
       }
@@ -34,7 +34,8 @@ namespace MR
         datatype (header.datatype()),
         segsize (Image::voxel_count (header)),
         is_new (false),
-        writable (false) { }
+        writable (false),
+        paged (false) { }
 
 
       Base::~Base () { }
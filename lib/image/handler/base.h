@@ -65,9 +65,26 @@ namespace MR
             is_new = image_is_new;
           }
 
+          //! the address of segment \a n, for read access
+          /*! for paged handlers, each call must be matched by a call to
+           * release() once access is complete. */
           uint8_t* segment (size_t n) const {
             assert (n < addresses.size());
-            return addresses[n];
+            return paged ? page (n, false) : addresses[n];
+          }
+          //! the address of segment \a n, for write access
+          uint8_t* segment_for_write (size_t n) const {
+            assert (n < addresses.size());
+            return paged ? page (n, true) : addresses[n];
+          }
+          //! signal that access to segment \a n is complete
+          void release (size_t n) const {
+            if (paged) 
+              unpage (n);
+          }
+          //! whether segments are loaded on demand (see Handler::PageCache)
+          bool is_paged () const {
+            return paged;
           }
           size_t nsegments () const {
             return addresses.size();
@@ -102,13 +119,21 @@ namespace MR
           const DataType datatype;
           size_t segsize;
           VecPtr<uint8_t,true> addresses;
-          bool is_new, writable;
+          bool is_new, writable, paged;
 
           void check () const {
             assert (addresses.size());
           }
           virtual void load () = 0;
           virtual void unload () = 0;
+          //! for handlers that set \a paged: return the address of segment \a n
+          virtual uint8_t* page (size_t n, bool modify) const {
+            assert (0);
+            return NULL;
+          }
+          virtual void unpage (size_t n) const {
+            assert (0);
+          }
       };
 
     }
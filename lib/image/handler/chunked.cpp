@@ -0,0 +1,416 @@
+/*
+    Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+    Written by agent, 17/10/26.
+
+    This file is part of MRtrix.
+
+    MRtrix is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    MRtrix is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <map>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "app.h"
+#include "get_set.h"
+#include "image/header.h"
+#include "image/handler/chunked.h"
+#include "thread/exec.h"
+#include "thread/mutex.h"
+
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Handler
+    {
+
+      class Chunked::Cache : public PageCache
+      {
+        public:
+          Cache (const File::Entry& entry, int64_t bytes_in_image, size_t number_of_chunks,
+              size_t bytes_per_chunk, bool readwrite, bool image_is_new);
+          ~Cache ();
+
+          //! write the chunk index back to file
+          void write_index ();
+
+        protected:
+          const std::string filename;
+          const int64_t index_offset, data_bytes;
+          int fd;
+          // the space reserved for each chunk in the file can exceed its
+          // current compressed size, if it was rewritten in place; space no
+          // longer used by any chunk is held as free extents for reuse:
+          std::vector<int64_t> offsets, sizes, capacities;
+          std::map<int64_t,int64_t> free_extents;
+          Thread::Mutex file_mutex;
+          int64_t file_end;
+
+          size_t chunk_bytes (size_t n) const {
+            return std::min (int64_t (slab_bytes), data_bytes - int64_t (n) * int64_t (slab_bytes));
+          }
+
+          virtual void read (size_t n, uint8_t* buffer);
+          virtual void write (size_t n, const uint8_t* buffer);
+          virtual void write (const std::vector<size_t>& chunks, const std::vector<uint8_t*>& buffers);
+
+          void compress (size_t n, const uint8_t* buffer, std::vector<uint8_t>& out) const;
+          void store (size_t n, const std::vector<uint8_t>& data);
+
+          // these should be invoked with file_mutex held:
+          int64_t allocate_extent (int64_t bytes);
+          void release_extent (int64_t offset, int64_t bytes);
+
+          class Encoder;
+      };
+
+
+
+
+      // compresses the chunks listed, using multiple threads. Copies of
+      // this functor are made for each thread, so all shared state is held
+      // in the Queue:
+      class Chunked::Cache::Encoder
+      {
+        public:
+          class Queue {
+            public:
+              Queue (const std::vector<size_t>& chunks, const std::vector<uint8_t*>& buffers) :
+                chunks (chunks), buffers (buffers), next (0) { }
+              const std::vector<size_t>& chunks;
+              const std::vector<uint8_t*>& buffers;
+              volatile size_t next;
+              Thread::Mutex mutex;
+              std::string error;
+          };
+
+          Encoder (Cache& cache, Queue& queue) : cache (cache), queue (queue) { }
+
+          void execute () {
+            std::vector<uint8_t> out;
+            size_t n;
+            while ((n = __sync_fetch_and_add (&queue.next, 1)) < queue.chunks.size()) {
+              try {
+                cache.compress (queue.chunks[n], queue.buffers[n], out);
+                cache.store (queue.chunks[n], out);
+              }
+              catch (Exception& E) {
+                Thread::Mutex::Lock lock (queue.mutex);
+                if (queue.error.empty())
+                  queue.error = E.description.size() ? E.description.back() : "unknown error";
+                queue.next = queue.chunks.size();
+                return;
+              }
+            }
+          }
+
+        protected:
+          Cache& cache;
+          Queue& queue;
+      };
+
+
+
+
+      Chunked::Cache::Cache (const File::Entry& entry, int64_t bytes_in_image, size_t number_of_chunks,
+          size_t bytes_per_chunk, bool readwrite, bool image_is_new) :
+        PageCache (number_of_chunks, bytes_per_chunk,
+            std::max (PageCache::budget() / bytes_per_chunk, size_t (1)), readwrite),
+        filename (entry.name),
+        index_offset (entry.start),
+        data_bytes (bytes_in_image),
+        offsets (number_of_chunks, 0),
+        sizes (number_of_chunks, 0),
+        capacities (number_of_chunks, 0),
+        file_end (entry.start + MRTRIX_CHUNK_INDEX_ENTRY_SIZE * int64_t (number_of_chunks))
+      {
+        fd = ::open (filename.c_str(), (writable ? O_RDWR : O_RDONLY) | O_BINARY);
+        if (fd < 0)
+          throw Exception ("error opening file \"" + filename + "\": " + strerror (errno));
+
+        if (image_is_new)
+          return;
+
+        std::vector<uint8_t> index (MRTRIX_CHUNK_INDEX_ENTRY_SIZE * number_of_chunks);
+        if (pread (fd, &index[0], index.size(), index_offset) != ssize_t (index.size())) {
+          ::close (fd);
+          throw Exception ("error reading chunk index for image \"" + filename + "\"");
+        }
+
+        struct stat sbuf;
+        fstat (fd, &sbuf);
+        std::map<int64_t,int64_t> used;
+        for (size_t n = 0; n < number_of_chunks; ++n) {
+          offsets[n] = getLE<uint64_t> (&index[0], 2*n);
+          sizes[n] = capacities[n] = getLE<uint64_t> (&index[0], 2*n+1);
+          if (sizes[n] && (offsets[n] < file_end || offsets[n] + sizes[n] > sbuf.st_size)) {
+            ::close (fd);
+            throw Exception ("invalid chunk index for image \"" + filename + "\" (file truncated?)");
+          }
+          if (sizes[n])
+            used[offsets[n]] = sizes[n];
+        }
+
+        // gaps between the chunks can be reused:
+        int64_t end = file_end;
+        for (std::map<int64_t,int64_t>::const_iterator i = used.begin(); i != used.end(); ++i) {
+          if (i->first > end)
+            free_extents[end] = i->first - end;
+          end = std::max (end, i->first + i->second);
+        }
+        file_end = writable ? end : int64_t (sbuf.st_size);
+      }
+
+
+
+      Chunked::Cache::~Cache ()
+      {
+        ::close (fd);
+      }
+
+
+
+
+      void Chunked::Cache::write_index ()
+      {
+        std::vector<uint8_t> index (MRTRIX_CHUNK_INDEX_ENTRY_SIZE * size());
+        for (size_t n = 0; n < size(); ++n) {
+          putLE<uint64_t> (offsets[n], &index[0], 2*n);
+          putLE<uint64_t> (sizes[n], &index[0], 2*n+1);
+        }
+        if (pwrite (fd, &index[0], index.size(), index_offset) != ssize_t (index.size()))
+          throw Exception ("error writing chunk index for image \"" + filename + "\": " + strerror (errno));
+
+        // drop any space freed at the end of the file:
+        struct stat sbuf;
+        if (!fstat (fd, &sbuf) && sbuf.st_size > file_end && ftruncate (fd, file_end))
+          throw Exception ("error truncating file \"" + filename + "\": " + strerror (errno));
+      }
+
+
+
+
+      void Chunked::Cache::read (size_t n, uint8_t* buffer)
+      {
+        const size_t count = chunk_bytes (n);
+        if (!sizes[n]) {
+          memset (buffer, 0, count);
+          return;
+        }
+
+        std::vector<uint8_t> in (sizes[n]);
+        if (pread (fd, &in[0], in.size(), offsets[n]) != ssize_t (in.size()))
+          throw Exception ("error reading from file \"" + filename + "\": " + strerror (errno));
+
+        uLongf out_size = count;
+        if (uncompress (buffer, &out_size, &in[0], in.size()) != Z_OK || out_size != count)
+          throw Exception ("error uncompressing chunk " + str(n) + " of image \"" + filename + "\"");
+      }
+
+
+
+
+      void Chunked::Cache::write (size_t n, const uint8_t* buffer)
+      {
+        std::vector<uint8_t> out;
+        compress (n, buffer, out);
+        store (n, out);
+      }
+
+
+
+      void Chunked::Cache::write (const std::vector<size_t>& chunks, const std::vector<uint8_t*>& buffers)
+      {
+        Encoder::Queue queue (chunks, buffers);
+        Encoder encoder (*this, queue);
+        if (Thread::number_of_threads() > 1 && chunks.size() > 1) {
+          Thread::Array<Encoder> encoders (encoder);
+          Thread::Exec threads (encoders, "compression threads");
+        }
+        else
+          encoder.execute();
+
+        if (queue.error.size())
+          throw Exception (queue.error);
+      }
+
+
+
+
+      void Chunked::Cache::compress (size_t n, const uint8_t* buffer, std::vector<uint8_t>& out) const
+      {
+        const size_t count = chunk_bytes (n);
+        uLongf out_size = compressBound (count);
+        out.resize (out_size);
+        if (compress2 (&out[0], &out_size, buffer, count, Z_DEFAULT_COMPRESSION) != Z_OK)
+          throw Exception ("error compressing chunk " + str(n) + " of image \"" + filename + "\"");
+        out.resize (out_size);
+      }
+
+
+
+
+      void Chunked::Cache::store (size_t n, const std::vector<uint8_t>& data)
+      {
+        int64_t offset;
+        {
+          // overwrite the previous version of the chunk if the new one fits,
+          // otherwise release its space and find room elsewhere:
+          Thread::Mutex::Lock lock (file_mutex);
+          if (int64_t (data.size()) > capacities[n]) {
+            if (capacities[n])
+              release_extent (offsets[n], capacities[n]);
+            offsets[n] = allocate_extent (data.size());
+            capacities[n] = data.size();
+          }
+          offset = offsets[n];
+        }
+
+        if (pwrite (fd, &data[0], data.size(), offset) != ssize_t (data.size()))
+          throw Exception ("error writing to file \"" + filename + "\": " + strerror (errno));
+        sizes[n] = data.size();
+      }
+
+
+
+
+      int64_t Chunked::Cache::allocate_extent (int64_t bytes)
+      {
+        // first fit, keeping the remainder of the extent free:
+        for (std::map<int64_t,int64_t>::iterator i = free_extents.begin(); i != free_extents.end(); ++i) {
+          if (i->second >= bytes) {
+            const int64_t offset = i->first, remainder = i->second - bytes;
+            free_extents.erase (i);
+            if (remainder)
+              free_extents[offset + bytes] = remainder;
+            return offset;
+          }
+        }
+        const int64_t offset = file_end;
+        file_end += bytes;
+        return offset;
+      }
+
+
+
+
+      void Chunked::Cache::release_extent (int64_t offset, int64_t bytes)
+      {
+        // merge with the neighbouring free extents:
+        std::map<int64_t,int64_t>::iterator i = free_extents.insert (std::make_pair (offset, bytes)).first;
+        std::map<int64_t,int64_t>::iterator next = i;
+        ++next;
+        if (next != free_extents.end() && i->first + i->second == next->first) {
+          i->second += next->second;
+          free_extents.erase (next);
+        }
+        if (i != free_extents.begin()) {
+          std::map<int64_t,int64_t>::iterator prev = i;
+          --prev;
+          if (prev->first + prev->second == i->first) {
+            prev->second += i->second;
+            free_extents.erase (i);
+            i = prev;
+          }
+        }
+        // space at the end of the file is simply given back:
+        if (i->first + i->second == file_end) {
+          file_end = i->first;
+          free_extents.erase (i);
+        }
+      }
+
+
+
+
+
+
+
+
+
+      Chunked::Chunked (const Image::Header& header, size_t voxels_per_chunk) :
+        Base (header),
+        chunk_voxels (voxels_per_chunk) { }
+
+
+
+      Chunked::~Chunked ()
+      {
+        close();
+      }
+
+
+
+      void Chunked::load ()
+      {
+        if (files.size() != 1)
+          throw Exception ("chunked image \"" + name + "\" should be stored in a single file");
+        if (!chunk_voxels || (datatype.bits() == 1 && chunk_voxels % 8 && chunk_voxels < segsize))
+          throw Exception ("invalid chunk size for image \"" + name + "\"");
+
+        const int64_t data_bytes = datatype.bits() == 1 ? (segsize+7)/8 : segsize * datatype.bytes();
+        const size_t chunk_bytes = datatype.bits() == 1 ? (chunk_voxels+7)/8 : chunk_voxels * datatype.bytes();
+        const size_t num_chunks = (segsize + chunk_voxels - 1) / chunk_voxels;
+
+        DEBUG ("accessing image \"" + name + "\" as " + str (num_chunks) + " compressed chunks of " + str (chunk_bytes) + " bytes...");
+        pages = new Cache (files[0], data_bytes, num_chunks, chunk_bytes, writable, is_new);
+
+        // entries remain NULL: all access goes via page()
+        addresses.resize (num_chunks);
+        segsize = chunk_voxels;
+        paged = true;
+      }
+
+
+
+      void Chunked::unload ()
+      {
+        if (writable) {
+          pages->flush();
+          pages->write_index();
+        }
+        pages = NULL;
+        paged = false;
+      }
+
+
+
+      uint8_t* Chunked::page (size_t n, bool modify) const
+      {
+        return pages->get (n, modify);
+      }
+
+
+      void Chunked::unpage (size_t n) const
+      {
+        pages->release (n);
+      }
+
+    }
+  }
+}
+
+
@@ -0,0 +1,75 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __image_handler_chunked_h__
+#define __image_handler_chunked_h__
+
+#include "image/handler/base.h"
+#include "image/handler/page_cache.h"
+
+#define MRTRIX_CHUNK_INDEX_ENTRY_SIZE 16
+
+namespace MR
+{
+  namespace Image
+  {
+
+    namespace Handler
+    {
+
+      //! handler for images stored as a sequence of independently compressed chunks
+      /*! The data are stored as chunks of \a voxels_per_chunk consecutive
+       * voxels, each compressed independently using zlib. The file entry
+       * points to an index holding the file offset and compressed size of
+       * each chunk (as little-endian 64-bit integers), which is followed by
+       * the chunks themselves. A chunk with zero size has never been written,
+       * and is read as all zeros.
+       *
+       * The chunks are accessed via a PageCache, so that only those chunks
+       * actually accessed are read and uncompressed, concurrently if accessed
+       * from multiple threads. Modified chunks are compressed when evicted
+       * from the cache, or in parallel when the image is closed. */
+      class Chunked : public Base
+      {
+        public:
+          Chunked (const Image::Header& header, size_t voxels_per_chunk);
+          ~Chunked ();
+
+        protected:
+          class Cache;
+
+          const size_t chunk_voxels;
+          RefPtr<Cache> pages;
+
+          virtual void load ();
+          virtual void unload ();
+          virtual uint8_t* page (size_t n, bool modify) const;
+          virtual void unpage (size_t n) const;
+      };
+
+    }
+  }
+}
+
+#endif
+
+
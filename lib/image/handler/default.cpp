@@ -23,10 +23,15 @@
 #include <limits>
 
 #include "app.h"
+#include "timer.h"
+#include "file/config.h"
 #include "file/ofstream.h"
+#include "file/write_behind.h"
 #include "image/header.h"
 #include "image/handler/default.h"
 #include "image/utils.h"
+#include "thread/mutex.h"
+#include "thread/queue.h"
 
 namespace MR
 {
@@ -35,6 +40,105 @@ namespace MR
     namespace Handler
     {
 
+      //! \cond skip
+      namespace
+      {
+
+        // the indices of the first of each run of consecutive entries stored
+        // in the same file, as with multi-frame DICOM images:
+        class RunSource
+        {
+          public:
+            RunSource (const std::vector<size_t>& runs) : runs (runs), next (0) { }
+            bool operator() (size_t& run) {
+              if (next+1 >= runs.size())
+                return false;
+              run = next++;
+              return true;
+            }
+          protected:
+            const std::vector<size_t>& runs;
+            size_t next;
+        };
+
+        // copy the contents of each run of entries into memory, in multiple
+        // threads. Files holding several entries are mapped only once:
+        class CopyRun
+        {
+          public:
+            CopyRun (const std::vector<File::Entry>& files, const std::vector<size_t>& runs,
+                uint8_t* data, int64_t bytes_per_segment, std::string& error, Thread::Mutex& mutex) :
+              files (files), runs (runs), data (data), bytes (bytes_per_segment),
+              error (error), mutex (mutex) { }
+
+            bool operator() (const size_t& run) {
+              try {
+                if (runs[run+1] - runs[run] == 1) {
+                  const size_t n = runs[run];
+                  File::MMap file (files[n], false, false, bytes, File::MMap::Sequential);
+                  memcpy (data + n*bytes, file.address(), bytes);
+                }
+                else {
+                  File::MMap file (File::Entry (files[runs[run]].name, 0), false, false, -1, File::MMap::WillNeed);
+                  for (size_t n = runs[run]; n < runs[run+1]; ++n) {
+                    if (files[n].start + bytes > file.size())
+                      throw Exception ("file \"" + files[n].name + "\" is smaller than expected");
+                    memcpy (data + n*bytes, file.address() + files[n].start, bytes);
+                  }
+                }
+              }
+              catch (Exception& E) {
+                Thread::Mutex::Lock lock (mutex);
+                if (error.empty())
+                  error = E.description.size() ? E.description.back() : "unknown error";
+                return false;
+              }
+              return true;
+            }
+
+          protected:
+            const std::vector<File::Entry>& files;
+            const std::vector<size_t>& runs;
+            uint8_t* data;
+            const int64_t bytes;
+            std::string& error;
+            Thread::Mutex& mutex;
+        };
+
+
+        // write the contents of an image held in RAM back to its files,
+        // taking ownership of the data:
+        class CopyToFiles : public File::WriteBehind::Job
+        {
+          public:
+            CopyToFiles (const std::vector<File::Entry>& files, uint8_t* data, int64_t bytes_per_segment) :
+              files (files), data (data), bytes (bytes_per_segment) { }
+            ~CopyToFiles () {
+              delete [] data;
+            }
+
+            virtual void execute () {
+              for (size_t n = 0; n < files.size(); n++) {
+                File::OFStream out (files[n].name, std::ios::in | std::ios::out | std::ios::binary);
+                out.seekp (files[n].start, out.beg);
+                out.write ((char*) (data + n*bytes), bytes);
+                if (!out.good())
+                  throw Exception ("error writing back contents of file \"" + files[n].name + "\": " + strerror(errno));
+              }
+            }
+
+          protected:
+            const std::vector<File::Entry> files;
+            uint8_t* const data;
+            const int64_t bytes;
+        };
+
+      }
+      //! \endcond
+
+
+
+
       void Default::load ()
       {
         if (files.empty())
@@ -52,8 +156,21 @@ namespace MR
         if (files.size() * double (bytes_per_segment) >= double (std::numeric_limits<size_t>::max()))
           throw Exception ("image \"" + name + "\" is larger than maximum accessible memory");
 
-        if (files.size() > MAX_FILES_PER_IMAGE) 
-          copy_to_mem ();
+        //CONF option: ImagePaging
+        //CONF default: 0 (false)
+        //CONF access all images via a bounded in-memory cache of slabs
+        //CONF loaded on demand (see ImagePageCacheSize), rather than by
+        //CONF memory-mapping. Images that would otherwise need to be loaded
+        //CONF into memory in their entirety are always accessed in this way
+        //CONF if they are larger than the cache.
+        if (File::Config::get_bool ("ImagePaging", false))
+          page_files ();
+        else if (files.size() > MAX_FILES_PER_IMAGE) {
+          if (files.size() * double (bytes_per_segment) > double (PageCache::budget()))
+            page_files ();
+          else
+            copy_to_mem ();
+        }
         else 
           map_files ();
       }
@@ -63,18 +180,20 @@ namespace MR
 
       void Default::unload ()
       {
-        if (mmaps.empty() && addresses.size()) {
+        if (pages) {
+          if (writable) 
+            pages->flush();
+          pages = NULL;
+          paged = false;
+        }
+        else if (mmaps.empty() && addresses.size()) {
           assert (addresses[0]);
 
-          if (writable) {
-            for (size_t n = 0; n < files.size(); n++) {
-              File::OFStream out (files[n].name, std::ios::out | std::ios::binary);
-              out.seekp (files[n].start, out.beg);
-              out.write ((char*) (addresses[0] + n*bytes_per_segment), bytes_per_segment);
-              if (!out.good())
-                throw Exception ("error writing back contents of file \"" + files[n].name + "\": " + strerror(errno));
-            }
-          }
+          // the other entries point into the same allocation:
+          for (size_t n = 1; n < addresses.size(); ++n)
+            addresses.release (n);
+          if (writable)
+            File::WriteBehind::submit (new CopyToFiles (files, addresses.release (0), bytes_per_segment));
         }
         else {
           for (size_t n = 0; n < addresses.size(); ++n)
@@ -100,6 +219,40 @@ namespace MR
 
 
 
+      void Default::page_files ()
+      {
+        //CONF option: ImagePageSize
+        //CONF default: 4096
+        //CONF the size (in kB) of the slabs of image data held in the page
+        //CONF cache (see ImagePaging).
+        const size_t page_size = 1024 * std::max (File::Config::get_int ("ImagePageSize", 4096), 1);
+
+        // slabs never span multiple files, and must all hold the same number
+        // of voxels for Buffer to locate them:
+        size_t slabs_per_file = 1;
+        size_t bytes_per_slab = bytes_per_segment;
+        if (files.size() == 1) {
+          size_t voxels_per_slab = std::max ((8 * page_size / datatype.bits()) & ~size_t (7), size_t (8));
+          if (voxels_per_slab < segsize) {
+            slabs_per_file = (segsize + voxels_per_slab - 1) / voxels_per_slab;
+            bytes_per_slab = datatype.bits() == 1 ? voxels_per_slab/8 : voxels_per_slab * datatype.bytes();
+            segsize = voxels_per_slab;
+          }
+        }
+
+        DEBUG ("paging image \"" + name + "\" in " + str (files.size() * slabs_per_file) + " slabs of " + str (bytes_per_slab) + " bytes...");
+        pages = new RawPageCache (files, bytes_per_segment, slabs_per_file, bytes_per_slab, 
+            std::max (PageCache::budget() / bytes_per_slab, size_t (1)), writable, is_new);
+
+        // entries remain NULL: all access goes via page()
+        addresses.resize (pages->size());
+        paged = true;
+      }
+
+
+
+
+
       void Default::copy_to_mem ()
       {
         DEBUG ("loading image \"" + name + "\"...");
@@ -110,10 +263,21 @@ namespace MR
 
         if (is_new) memset (addresses[0], 0, files.size() * bytes_per_segment);
         else {
-          for (size_t n = 0; n < files.size(); n++) {
-            File::MMap file (files[n], false, false, bytes_per_segment);
-            memcpy (addresses[0] + n*bytes_per_segment, file.address(), bytes_per_segment);
-          }
+          Timer timer;
+          std::vector<size_t> runs (1, 0);
+          for (size_t n = 1; n < files.size(); n++)
+            if (files[n].name != files[n-1].name)
+              runs.push_back (n);
+          runs.push_back (files.size());
+
+          std::string error;
+          Thread::Mutex mutex;
+          RunSource source (runs);
+          CopyRun copy (files, runs, addresses[0], bytes_per_segment, error, mutex);
+          Thread::run_queue (source, size_t(), Thread::multi (copy));
+          if (error.size())
+            throw Exception ("error loading image \"" + name + "\": " + error);
+          INFO ("loaded " + str (files.size()) + " image files for \"" + name + "\" in " + str (timer.elapsed()) + " seconds");
         }
 
         if (addresses.size() > 1)
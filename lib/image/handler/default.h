@@ -26,6 +26,7 @@
 #include "types.h"
 #include "image/handler/base.h"
 #include "file/mmap.h"
+#include "image/handler/page_cache.h"
 
 namespace MR
 {
@@ -45,12 +46,20 @@ namespace MR
 
         protected:
           std::vector<RefPtr<File::MMap> > mmaps;
+          RefPtr<PageCache> pages;
           int64_t bytes_per_segment;
 
           virtual void load ();
           virtual void unload ();
+          virtual uint8_t* page (size_t n, bool modify) const {
+            return pages->get (n, modify);
+          }
+          virtual void unpage (size_t n) const {
+            pages->release (n);
+          }
 
           void map_files ();
+          void page_files ();
           void copy_to_mem ();
           void copy_to_files ();
 
@@ -28,8 +28,8 @@
 #include "image/handler/gz.h"
 #include "image/utils.h"
 #include "file/gz.h"
-
-#define BYTES_PER_ZCALL 524288
+#include "file/gz_blocks.h"
+#include "file/write_behind.h"
 
 namespace MR
 {
@@ -38,6 +38,53 @@ namespace MR
     namespace Handler
     {
 
+      //! \cond skip
+      namespace
+      {
+
+        // compress the contents of an image held in RAM to its files, taking
+        // ownership of the data:
+        class Compress : public File::WriteBehind::Job
+        {
+          public:
+            Compress (const std::string& image_name, const std::vector<File::Entry>& files,
+                const uint8_t* lead_in, size_t lead_in_size, uint8_t* data, int64_t bytes_per_segment) :
+              name (image_name), files (files),
+              lead_in (lead_in, lead_in + (lead_in ? lead_in_size : 0)),
+              data (data), bytes (bytes_per_segment) { }
+            ~Compress () {
+              delete [] data;
+            }
+
+            virtual void execute () {
+              // progress can only be shown if running in the foreground:
+              Ptr<ProgressBar> progress;
+              if (!File::WriteBehind::enabled())
+                progress = new ProgressBar ("compressing image \"" + name + "\"...",
+                    files.size() * bytes / MRTRIX_GZ_BLOCK_SIZE);
+              for (size_t n = 0; n < files.size(); n++) {
+                assert (files[n].start == int64_t (lead_in.size()));
+                // written as independent blocks, compressed in parallel:
+                File::GZBlocks::write (files[n].name,
+                    lead_in.size() ? &lead_in[0] : NULL, lead_in.size(),
+                    data + n*bytes, bytes, progress);
+              }
+            }
+
+          protected:
+            const std::string name;
+            const std::vector<File::Entry> files;
+            const std::vector<uint8_t> lead_in;
+            uint8_t* const data;
+            const int64_t bytes;
+        };
+
+      }
+      //! \endcond
+
+
+
+
       void GZ::load ()
       {
         if (files.empty())
@@ -58,18 +105,23 @@ namespace MR
           memset (addresses[0], 0, files.size() * bytes_per_segment);
         else {
           ProgressBar progress ("uncompressing image \"" + name + "\"...",
-                                files.size() * bytes_per_segment / BYTES_PER_ZCALL);
+                                files.size() * bytes_per_segment / MRTRIX_GZ_BLOCK_SIZE);
           for (size_t n = 0; n < files.size(); n++) {
+            uint8_t* address = addresses[0] + n*bytes_per_segment;
+
+            // files written by MRtrix can be uncompressed in parallel:
+            if (File::GZBlocks::read (files[n].name, files[n].start, address, bytes_per_segment, &progress))
+              continue;
+
             File::GZ zf (files[n].name, "rb");
             zf.seek (files[n].start);
-            uint8_t* address = addresses[0] + n*bytes_per_segment;
-            uint8_t* last = address + bytes_per_segment - BYTES_PER_ZCALL;
+            uint8_t* last = address + bytes_per_segment - MRTRIX_GZ_BLOCK_SIZE;
             while (address < last) {
-              zf.read (reinterpret_cast<char*> (address), BYTES_PER_ZCALL);
-              address += BYTES_PER_ZCALL;
+              zf.read (reinterpret_cast<char*> (address), MRTRIX_GZ_BLOCK_SIZE);
+              address += MRTRIX_GZ_BLOCK_SIZE;
               ++progress;
             }
-            last += BYTES_PER_ZCALL;
+            last += MRTRIX_GZ_BLOCK_SIZE;
             zf.read (reinterpret_cast<char*> (address), last - address);
           }
         }
@@ -88,26 +140,12 @@ namespace MR
         if (addresses.size()) {
           assert (addresses[0]);
 
-          if (writable) {
-            ProgressBar progress ("compressing image \"" + name + "\"...",
-                                  files.size() * bytes_per_segment / BYTES_PER_ZCALL);
-            for (size_t n = 0; n < files.size(); n++) {
-              assert (files[n].start == int64_t (lead_in_size));
-              File::GZ zf (files[n].name, "wb");
-              if (lead_in)
-                zf.write (reinterpret_cast<const char*> (lead_in), lead_in_size);
-              uint8_t* address = addresses[0] + n*bytes_per_segment;
-              uint8_t* last = address + bytes_per_segment - BYTES_PER_ZCALL;
-              while (address < last) {
-                zf.write (reinterpret_cast<const char*> (address), BYTES_PER_ZCALL);
-                address += BYTES_PER_ZCALL;
-                ++progress;
-              }
-              last += BYTES_PER_ZCALL;
-              zf.write (reinterpret_cast<const char*> (address), last - address);
-            }
-          }
-
+          // the other entries point into the same allocation:
+          for (size_t n = 1; n < addresses.size(); ++n)
+            addresses.release (n);
+          if (writable)
+            File::WriteBehind::submit (new Compress (name, files, lead_in, lead_in_size,
+                  addresses.release (0), bytes_per_segment));
         }
       }
 
@@ -24,9 +24,12 @@
 
 #include "app.h"
 #include "progressbar.h"
+#include "timer.h"
 #include "image/header.h"
 #include "image/handler/mosaic.h"
 #include "image/utils.h"
+#include "thread/mutex.h"
+#include "thread/queue.h"
 
 namespace MR
 {
@@ -35,6 +38,89 @@ namespace MR
     namespace Handler
     {
 
+      //! \cond skip
+      namespace
+      {
+
+        class FileSource
+        {
+          public:
+            FileSource (size_t num_files) : num_files (num_files), next (0) { }
+            bool operator() (size_t& index) {
+              if (next >= num_files)
+                return false;
+              index = next++;
+              return true;
+            }
+          protected:
+            const size_t num_files;
+            size_t next;
+        };
+
+        // de-tile the slices of each mosaic file into the image data, in
+        // multiple threads. Each file is written to its own segment of the
+        // data, so no locking is required other than to report errors:
+        class Detile
+        {
+          public:
+            Detile (const std::vector<File::Entry>& files, uint8_t* data, size_t bytes_per_voxel,
+                size_t m_xdim, size_t m_ydim, size_t xdim, size_t ydim, size_t slices,
+                std::string& error, Thread::Mutex& mutex) :
+              files (files), data (data), bytes (bytes_per_voxel),
+              m_xdim (m_xdim), m_ydim (m_ydim), xdim (xdim), ydim (ydim), slices (slices),
+              error (error), mutex (mutex) { }
+
+            bool operator() (const size_t& index, size_t& out) {
+              Ptr<File::MMap> file;
+              try {
+                file = new File::MMap (files[index], false, false, m_xdim * m_ydim * bytes, File::MMap::WillNeed);
+              }
+              catch (Exception& E) {
+                Thread::Mutex::Lock lock (mutex);
+                if (error.empty())
+                  error = E.description.size() ? E.description.back() : "unknown error";
+                return false;
+              }
+              const size_t row_bytes = xdim * bytes;
+              const size_t tiles_per_row = m_xdim / xdim;
+              uint8_t* dest = data + index * slices * ydim * row_bytes;
+              for (size_t z = 0; z < slices; ++z) {
+                const uint8_t* src = file->address() + bytes * ((z % tiles_per_row) * xdim + (z / tiles_per_row) * ydim * m_xdim);
+                for (size_t y = 0; y < ydim; ++y) {
+                  memcpy (dest, src, row_bytes);
+                  dest += row_bytes;
+                  src += m_xdim * bytes;
+                }
+              }
+              out = index;
+              return true;
+            }
+
+          protected:
+            const std::vector<File::Entry>& files;
+            uint8_t* data;
+            const size_t bytes, m_xdim, m_ydim, xdim, ydim, slices;
+            std::string& error;
+            Thread::Mutex& mutex;
+        };
+
+        class DetileProgress
+        {
+          public:
+            DetileProgress (ProgressBar& progress) : progress (progress) { }
+            bool operator() (const size_t& index) {
+              ++progress;
+              return true;
+            }
+          protected:
+            ProgressBar& progress;
+        };
+
+      }
+      //! \endcond
+
+
+
 
       void Mosaic::load ()
       {
@@ -53,26 +139,19 @@ namespace MR
         if (!addresses[0])
           throw Exception ("failed to allocate memory for image \"" + name + "\"");
 
-        ProgressBar progress ("reformatting DICOM mosaic images...", slices*files.size());
-        uint8_t* data = addresses[0];
-        for (size_t n = 0; n < files.size(); n++) {
-          File::MMap file (files[n], false, false, m_xdim * m_ydim * datatype.bytes());
-          size_t nx = 0, ny = 0;
-          for (size_t z = 0; z < slices; z++) {
-            size_t ox = nx*xdim;
-            size_t oy = ny*ydim;
-            for (size_t y = 0; y < ydim; y++) {
-              memcpy (data, file.address() + datatype.bytes() * (ox + m_xdim* (y+oy)), xdim * datatype.bytes());
-              data += xdim * datatype.bytes();
-            }
-            nx++;
-            if (nx >= m_xdim / xdim) {
-              nx = 0;
-              ny++;
-            }
-            ++progress;
-          }
+        Timer timer;
+        {
+          ProgressBar progress ("reformatting DICOM mosaic images...", files.size());
+          std::string error;
+          Thread::Mutex mutex;
+          FileSource source (files.size());
+          Detile detile (files, addresses[0], datatype.bytes(), m_xdim, m_ydim, xdim, ydim, slices, error, mutex);
+          DetileProgress sink (progress);
+          Thread::run_queue (source, size_t(), Thread::multi (detile), size_t(), sink);
+          if (error.size())
+            throw Exception ("error reformatting DICOM mosaic image \"" + name + "\": " + error);
         }
+        INFO ("reformatted " + str (files.size()) + " DICOM mosaic images in " + str (timer.elapsed()) + " seconds");
 
         segsize = std::numeric_limits<size_t>::max();
       }
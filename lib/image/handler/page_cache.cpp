@@ -0,0 +1,279 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "app.h"
+#include "file/config.h"
+#include "thread/exec.h"
+#include "image/handler/page_cache.h"
+
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Handler
+    {
+
+      size_t PageCache::budget ()
+      {
+        //CONF option: ImagePageCacheSize
+        //CONF default: 1024
+        //CONF the maximum amount of memory (in MB) used to hold the data
+        //CONF of each image accessed via the page cache (see ImagePaging).
+        return 1048576 * size_t (std::max (File::Config::get_int ("ImagePageCacheSize", 1024), 1));
+      }
+
+
+
+
+      PageCache::PageCache (size_t number_of_slabs, size_t bytes_per_slab, size_t capacity, bool readwrite) :
+        slab_bytes (bytes_per_slab),
+        // at least one slab must remain unpinned for eviction:
+        max_slabs (std::max (capacity, Thread::number_of_threads() + 1)),
+        writable (readwrite),
+        loaded (mutex),
+        table (number_of_slabs, NULL),
+        referenced (number_of_slabs, 0),
+        dirty (number_of_slabs, 0),
+        loading (number_of_slabs, 0),
+        pins (number_of_slabs, 0),
+        hand (0),
+        misses (0),
+        writebacks (0) { }
+
+
+
+
+      PageCache::~PageCache ()
+      {
+        DEBUG ("page cache: " + str (misses) + " slabs loaded, " + str (writebacks) + " written back, "
+            + str (buffers.size()) + " of " + str (max_slabs) + " slabs of " + str (slab_bytes) + " bytes allocated");
+      }
+
+
+
+
+      void PageCache::flush ()
+      {
+        Thread::Mutex::Lock lock (mutex);
+        std::vector<size_t> slabs;
+        std::vector<uint8_t*> slab_buffers;
+        for (size_t n = 0; n < table.size(); ++n) {
+          if (table[n] && dirty[n]) {
+            slabs.push_back (n);
+            slab_buffers.push_back (table[n]);
+          }
+        }
+        if (slabs.empty())
+          return;
+
+        write (slabs, slab_buffers);
+        for (size_t n = 0; n < slabs.size(); ++n)
+          dirty[slabs[n]] = 0;
+        writebacks += slabs.size();
+      }
+
+
+
+      void PageCache::write (const std::vector<size_t>& slabs, const std::vector<uint8_t*>& slab_buffers)
+      {
+        for (size_t n = 0; n < slabs.size(); ++n)
+          write (slabs[n], slab_buffers[n]);
+      }
+
+
+
+
+      uint8_t* PageCache::fetch (size_t n, bool modify)
+      {
+        Thread::Mutex::Lock lock (mutex);
+        __sync_fetch_and_add (&pins[n], 1);
+
+        // another thread may be loading the slab, or have loaded it while we
+        // were waiting:
+        while (loading[n])
+          loaded.wait();
+
+        if (!table[n]) {
+          loading[n] = 1;
+          uint8_t* buffer = allocate();
+
+          mutex.unlock();
+          try {
+            read (n, buffer);
+          }
+          catch (...) {
+            mutex.lock();
+            spare.push_back (buffer);
+            loading[n] = 0;
+            __sync_fetch_and_sub (&pins[n], 1);
+            loaded.broadcast();
+            throw;
+          }
+          mutex.lock();
+
+          clock.push_back (n);
+          ++misses;
+
+          // make sure the data are visible before publishing the address:
+          __sync_synchronize();
+          table[n] = buffer;
+          loading[n] = 0;
+          loaded.broadcast();
+        }
+
+        referenced[n] = 1;
+        if (modify && writable)
+          dirty[n] = 1;
+        return table[n];
+      }
+
+
+
+
+      uint8_t* PageCache::allocate ()
+      {
+        if (spare.size()) {
+          uint8_t* buffer = spare.back();
+          spare.pop_back();
+          return buffer;
+        }
+        if (buffers.size() < max_slabs) {
+          buffers.push_back (new uint8_t [slab_bytes]);
+          return buffers.back();
+        }
+        return evict();
+      }
+
+
+
+
+      uint8_t* PageCache::evict ()
+      {
+        assert (clock.size());
+        while (true) {
+          if (hand >= clock.size())
+            hand = 0;
+          const size_t n = clock[hand];
+          if (referenced[n]) {
+            referenced[n] = 0;
+            ++hand;
+            continue;
+          }
+
+          uint8_t* buffer = table[n];
+          table[n] = NULL;
+          // a thread may have pinned the slab before seeing it removed; it
+          // will then see it removed, and unpin it (see get()):
+          __sync_synchronize();
+          if (pins[n]) {
+            table[n] = buffer;
+            ++hand;
+            continue;
+          }
+
+          clock[hand] = clock.back();
+          clock.pop_back();
+          if (dirty[n]) {
+            write (n, buffer);
+            dirty[n] = 0;
+            ++writebacks;
+          }
+          return buffer;
+        }
+      }
+
+
+
+
+
+
+
+      RawPageCache::RawPageCache (const std::vector<File::Entry>& image_files, int64_t bytes_per_file,
+          size_t number_of_slabs_per_file, size_t bytes_per_slab, size_t capacity,
+          bool readwrite, bool image_is_new) :
+        PageCache (image_files.size() * number_of_slabs_per_file, bytes_per_slab, capacity, readwrite),
+        files (image_files),
+        file_bytes (bytes_per_file),
+        slabs_per_file (number_of_slabs_per_file),
+        on_disk (size(), !image_is_new) { }
+
+
+
+
+      void RawPageCache::read (size_t n, uint8_t* buffer)
+      {
+        size_t count = on_disk[n] ? transfer (n, buffer, false) : 0;
+        memset (buffer + count, 0, slab_bytes - count);
+      }
+
+
+
+      void RawPageCache::write (size_t n, const uint8_t* buffer)
+      {
+        assert (writable);
+        transfer (n, const_cast<uint8_t*> (buffer), true);
+        on_disk[n] = 1;
+      }
+
+
+
+      size_t RawPageCache::transfer (size_t n, uint8_t* buffer, bool to_file)
+      {
+        const File::Entry& entry (files[n / slabs_per_file]);
+        const int64_t start = (n % slabs_per_file) * int64_t (slab_bytes);
+        const size_t count = std::min (int64_t (slab_bytes), file_bytes - start);
+
+        int fid = open (entry.name.c_str(), (to_file ? O_WRONLY : O_RDONLY) | O_BINARY);
+        if (fid < 0)
+          throw Exception ("error opening file \"" + entry.name + "\": " + strerror (errno));
+
+        size_t done = 0;
+        while (done < count) {
+          const ssize_t ret = to_file ?
+            pwrite (fid, buffer + done, count - done, entry.start + start + done) :
+            pread (fid, buffer + done, count - done, entry.start + start + done);
+          if (ret <= 0) {
+            const std::string error = ret ? strerror (errno) : "unexpected end of file";
+            close (fid);
+            throw Exception (std::string ("error ") + (to_file ? "writing to" : "reading from") + " file \"" + entry.name + "\": " + error);
+          }
+          done += ret;
+        }
+
+        close (fid);
+        return count;
+      }
+
+    }
+  }
+}
+
+
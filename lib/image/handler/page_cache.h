@@ -0,0 +1,159 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __image_handler_page_cache_h__
+#define __image_handler_page_cache_h__
+
+#include <vector>
+
+#include "types.h"
+#include "ptr.h"
+#include "file/entry.h"
+#include "thread/mutex.h"
+#include "thread/condition.h"
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Handler
+    {
+
+      //! A bounded cache of fixed-size slabs of image data
+      /*! This is used to access images that are too large to be held in
+       * memory, or that cannot be memory-mapped. The image data are split into
+       * \a number_of_slabs slabs of \a bytes_per_slab, which are loaded on
+       * first access, and held in a cache of at most \a capacity slabs.
+       * Slabs are evicted using the CLOCK algorithm (an approximation to LRU
+       * that does not require any locking on access), and written back on
+       * eviction if they have been modified.
+       *
+       * Each access to a slab must be bracketed by calls to get() and
+       * release(): the slab is pinned in the meantime, and will not be
+       * evicted until it has been released.
+       *
+       * The actual storage of the slabs is handled by the derived classes,
+       * via the read() and write() methods. Slabs are read without holding
+       * the cache lock, so that different slabs can be loaded (and if
+       * necessary uncompressed) concurrently by different threads. */
+      class PageCache
+      {
+        public:
+          PageCache (size_t number_of_slabs, size_t bytes_per_slab, size_t capacity, bool readwrite);
+          virtual ~PageCache ();
+
+          //! pin slab \a n and return its address, loading it if necessary
+          /*! if \a modify is true, the slab will be written back when
+           * evicted. */
+          uint8_t* get (size_t n, bool modify) {
+            assert (n < table.size());
+            uint8_t* address = table[n];
+            if (address) {
+              __sync_fetch_and_add (&pins[n], 1);
+              // check the slab was not evicted before it was pinned:
+              if (table[n] != address) {
+                release (n);
+                return fetch (n, modify);
+              }
+              // only write the flags if they need changing, to avoid
+              // invalidating the cache line of other threads:
+              if (!referenced[n]) referenced[n] = 1;
+              if (modify && writable && !dirty[n]) dirty[n] = 1;
+              return address;
+            }
+            return fetch (n, modify);
+          }
+
+          //! unpin slab \a n
+          void release (size_t n) {
+            assert (pins[n]);
+            __sync_fetch_and_sub (&pins[n], 1);
+          }
+
+          //! write all modified slabs back to storage
+          void flush ();
+
+          size_t size () const { return table.size(); }
+          size_t slab_size () const { return slab_bytes; }
+
+          //! the maximum amount of memory (in bytes) each cache should use
+          static size_t budget ();
+
+        protected:
+          const size_t slab_bytes, max_slabs;
+          const bool writable;
+
+          //! load the contents of slab \a n into \a buffer
+          virtual void read (size_t n, uint8_t* buffer) = 0;
+          //! write back the contents of slab \a n
+          virtual void write (size_t n, const uint8_t* buffer) = 0;
+          //! write back the slabs listed in \a slabs, held in \a buffers
+          /*! by default, this invokes write() for each slab in turn. */
+          virtual void write (const std::vector<size_t>& slabs, const std::vector<uint8_t*>& buffers);
+
+        private:
+          Thread::Mutex mutex;
+          Thread::Cond loaded;
+          // these are read and written without locking on access.
+          // std::vector<bool> cannot be used here, since its elements
+          // would not be independently writable from different threads:
+          std::vector<uint8_t*> table;
+          std::vector<uint8_t> referenced, dirty, loading;
+          std::vector<int> pins;
+          VecPtr<uint8_t,true> buffers;
+          std::vector<uint8_t*> spare;
+          std::vector<size_t> clock;
+          size_t hand, misses, writebacks;
+
+          uint8_t* fetch (size_t n, bool modify);
+          uint8_t* allocate ();
+          uint8_t* evict ();
+      };
+
+
+
+
+      //! A PageCache for uncompressed data stored in one or more files
+      class RawPageCache : public PageCache
+      {
+        public:
+          RawPageCache (const std::vector<File::Entry>& image_files, int64_t bytes_per_file,
+              size_t slabs_per_file, size_t bytes_per_slab, size_t capacity,
+              bool readwrite, bool image_is_new);
+
+        protected:
+          const std::vector<File::Entry>& files;
+          const int64_t file_bytes;
+          const size_t slabs_per_file;
+          std::vector<uint8_t> on_disk;
+
+          virtual void read (size_t n, uint8_t* buffer);
+          virtual void write (size_t n, const uint8_t* buffer);
+          size_t transfer (size_t n, uint8_t* buffer, bool to_file);
+      };
+
+    }
+  }
+}
+
+#endif
+
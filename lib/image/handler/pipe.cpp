@@ -25,6 +25,7 @@
 
 #include "app.h"
 #include "image/header.h"
+#include "file/write_behind.h"
 #include "image/handler/pipe.h"
 #include "image/utils.h"
 
@@ -67,8 +68,12 @@ namespace MR
       {
         if (mmap) {
           mmap = NULL;
-          if (is_new)
+          // the next command in the pipeline must not open the file
+          //   until its contents have been written back:
+          if (is_new) {
+            File::WriteBehind::finish();
             std::cout << files[0].name << "\n";
+          }
           addresses[0] = NULL;
         }
       }
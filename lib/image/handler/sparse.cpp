@@ -21,6 +21,11 @@
 */
 
 
+#include <cerrno>
+#include <cstdlib>
+
+#include "file/ofstream.h"
+#include "file/write_behind.h"
 #include "image/handler/sparse.h"
 
 
@@ -38,7 +43,9 @@ namespace MR
           class_name (sparse_class),
           class_size (sparse_size),
           file (entry),
-          data_end (0) { }
+          data_end (0),
+          block_bits (0),
+          num_blocks (0) { }
 
 
       void Sparse::load()
@@ -52,26 +59,37 @@ namespace MR
         stream.close();
         const uint64_t current_sparse_data_size = file_size - file.start;
 
-        if (current_sparse_data_size) {
-
-          mmap = new File::MMap (file, Base::writable, true, current_sparse_data_size);
-          data_end = current_sparse_data_size;
-
-        } else if (Base::writable) {
+        if (Base::writable) {
 
           // Default = initialise 16MB, this is enough to store whole-brain fixel data at 2.5mm resolution
-          const uint64_t init_sparse_data_size = File::Config::get_int ("SparseDataInitialSize", 16777216);
-          const size_t new_file_size = file.start + init_sparse_data_size;
-          DEBUG ("Initialising output sparse data file " + file.name + ": new file size " + str(new_file_size) + " (" + str(init_sparse_data_size) + " of which is initial sparse data buffer)");
-          File::resize (file.name, new_file_size);
-          mmap = new File::MMap (file, Base::writable, false, init_sparse_data_size);
+          // Subsequent blocks double in size each time, so this only affects the number of blocks needed
+          const uint64_t init_sparse_data_size = std::max (File::Config::get_int ("SparseDataInitialSize", 16777216), 4096);
+          block_bits = 12;
+          while ((uint64_t(1) << block_bits) < std::max (init_sparse_data_size, current_sparse_data_size))
+            ++block_bits;
+          blocks.reserve (64 - block_bits);
+          allocate_blocks (0);
+          DEBUG ("Initialising sparse data buffer for file " + file.name + ": initial size " + str(uint64_t(1) << block_bits));
+
+          if (current_sparse_data_size) {
+            File::WriteBehind::finish();
+            std::ifstream in (file.name.c_str(), std::ios::in | std::ios::binary);
+            in.seekg (file.start, in.beg);
+            in.read ((char*) blocks[0], current_sparse_data_size);
+            if (!in.good())
+              throw Exception ("error reading sparse data from file \"" + file.name + "\": " + strerror(errno));
+            data_end = current_sparse_data_size;
+          } else {
+            // Any voxel that has its value initialised to 0 will point to the uint32_t(0) at the start
+            //   of the sparse data region (the blocks are zero-filled on allocation), and therefore
+            //   dereferencing of any such voxel will yield a Sparse::Value with zero elements
+            data_end = sizeof(uint32_t);
+          }
 
-          // Writes a single uint32_t(0) to the start of the sparse data region
-          // Any voxel that has its value initialised to 0 will point here, and therefore dereferencing of any
-          //   such voxel will yield a Sparse::Value with zero elements
-          memset (off2mem (0), 0x00, sizeof (uint32_t));
+        } else if (current_sparse_data_size) {
 
-          data_end = sizeof(uint32_t);
+          mmap = new File::MMap (file, false, true, current_sparse_data_size, File::MMap::Random);
+          data_end = current_sparse_data_size;
 
         }
 
@@ -92,17 +110,32 @@ namespace MR
 
         Default::unload();
 
-        const uint64_t truncate_file_size = (data_end == size()) ? 0 : file.start + data_end;
-        // Null the excess data before closing the memory map to prevent std::ofstream from giving an error
-        //   (writing uninitialised values)
-        memset (off2mem(data_end), 0x00, size() - data_end);
+        if (Base::writable) {
+          // Write the sparse data out in one go, and truncate the file to the exact size required
+          DEBUG ("writing " + str(data_end) + " bytes of sparse data to file " + file.name + " in " + str(num_blocks) + " blocks");
+          File::OFStream out (file.name, std::ios::in | std::ios::out | std::ios::binary);
+          out.seekp (file.start, out.beg);
+          for (size_t n = 0; n < num_blocks && block_start (n, block_bits) < data_end; ++n)
+            out.write ((const char*) blocks[n], std::min (uint64_t(1) << (n + block_bits), data_end - block_start (n, block_bits)));
+          if (!out.good())
+            throw Exception ("error writing sparse data to file \"" + file.name + "\": " + strerror(errno));
+          out.close();
+          File::resize (file.name, file.start + data_end);
+          free_blocks();
+        }
+
         mmap = NULL;
 
-        if (truncate_file_size) {
-          DEBUG ("truncating sparse image data file " + file.name + " to " + str(truncate_file_size) + " bytes");
-          File::resize (file.name, truncate_file_size);
-        }
+      }
+
+
 
+      void Sparse::free_blocks ()
+      {
+        for (size_t n = 0; n < num_blocks; ++n)
+          free (blocks[n]);
+        blocks.clear();
+        num_blocks = 0;
       }
 
 
@@ -155,40 +188,51 @@ namespace MR
         if (!numel)
           return 0;
 
-        const int64_t requested_size = sizeof (uint32_t) + (numel * class_size);
-        if (data_end + requested_size > size()) {
+        const uint64_t ret = allocate (sizeof (uint32_t) + (numel * class_size));
 
-          // size() should never be empty if data is being written...
-          assert (size());
-          uint64_t new_sparse_data_size = 2 * size();
+        // Write the uint32_t indicating the number of elements in this voxel
+        memcpy (off2mem(ret), &numel, sizeof(uint32_t));
 
-          // Cover rare case where a huge memory request occurs early
-          while (new_sparse_data_size < data_end + requested_size)
-            new_sparse_data_size *= 2;
+        // The return value is the offset from the beginning of the sparse data
+        return ret;
+      }
 
-          // Memory error arises due to the uninitialised data between the end of the sparse data and the end
-          //   of the file at its current size being written using std::ofstream
-          // Therefore, explicitly null all data that hasn't already been written
-          //   (this does not prohibit the use of this memory for subsequent sparse data though)
-          memset (off2mem(data_end), 0x00, size() - data_end);
 
-          mmap = NULL;
 
-          const size_t new_file_size = file.start + new_sparse_data_size;
-          DEBUG ("Resizing sparse data file " + file.name + ": new file size " + str(new_file_size) + " (" + str(new_sparse_data_size) + " of which is for sparse data)");
-          File::resize (file.name, new_file_size);
-          mmap = new File::MMap (file, Base::writable, true, new_sparse_data_size);
 
+      uint64_t Sparse::allocate (const uint64_t size)
+      {
+        while (true) {
+          const uint64_t start = __sync_fetch_and_add (&data_end, size);
+          const size_t n = block_index (start, block_bits);
+          allocate_blocks (n);
+          if (start + size <= block_start (n+1, block_bits))
+            return start;
+          // This would straddle two blocks; leave the remainder of this block unused, and try again from the next one
         }
+      }
 
-        // Write the uint32_t indicating the number of elements in this voxel
-        memcpy (off2mem(data_end), &numel, sizeof(uint32_t));
 
-        // The return value is the offset from the beginning of the sparse data
-        const uint64_t ret = data_end;
-        data_end += requested_size;
 
-        return ret;
+      void Sparse::allocate_blocks (const size_t n)
+      {
+        if (n < num_blocks)
+          return;
+        Thread::Mutex::Lock lock (mutex);
+        while (num_blocks <= n) {
+          if (num_blocks >= blocks.capacity())
+            throw Exception ("sparse data for image \"" + name + "\" exceeds maximum size");
+          const uint64_t block_size = uint64_t(1) << (num_blocks + block_bits);
+          DEBUG ("Allocating block of " + str(block_size) + " bytes for sparse data of image " + name);
+          // calloc() provides zero-filled memory without touching pages that will not be used
+          uint8_t* block = static_cast<uint8_t*> (calloc (block_size, 1));
+          if (!block)
+            throw Exception ("failed to allocate memory for sparse data of image \"" + name + "\"");
+          blocks.push_back (block);
+          // make sure the block is visible to other threads before they can access it:
+          __sync_synchronize();
+          ++num_blocks;
+        }
       }
 
 
@@ -35,6 +35,7 @@
 #include "file/utils.h"
 #include "image/handler/base.h"
 #include "image/handler/default.h"
+#include "thread/mutex.h"
 
 
 
@@ -70,6 +71,12 @@ namespace MR
       //     be determined from the sparse data alone, the relevant Image::Format instead enforces
       //     the endianness of the image data to be native, and assumes that the sparse data has
       //     the same endianness. If the endianness does not match, the file won't open.
+      // * When the image is opened for writing, the sparse data are held in RAM in blocks of
+      //     geometrically increasing size, which are never moved once allocated; they are written to
+      //     file in one go when the image is closed. New sparse data are appended using an atomic
+      //     increment of data_end, so that different threads can write the sparse data of different
+      //     voxels concurrently. An allocation never straddles two blocks: the remainder of the
+      //     block is left as zero-filled padding instead, which is never referenced by any voxel.
 
 
 
@@ -78,7 +85,7 @@ namespace MR
         public:
           Sparse (Default& handler, const std::string&, const size_t, const File::Entry entry);
 
-          ~Sparse () { close(); }
+          ~Sparse () { close(); free_blocks(); }
 
 
           // Find the number of elements in a particular voxel based on the file offset
@@ -88,6 +95,7 @@ namespace MR
           //   sufficiently large to contain the new information
           // Receives current offset value for that voxel, and the desired number of elements
           // Return value is the offset from the start of the sparse data
+          // This can be invoked concurrently from multiple threads, provided they operate on different voxels
           uint64_t set_numel (const uint64_t, const uint32_t);
 
           // Return a pointer to an element in a voxel
@@ -105,14 +113,36 @@ namespace MR
           const std::string class_name;
           const size_t class_size;
           const File::Entry file;
-          uint64_t data_end;
+          volatile uint64_t data_end;
           Ptr<File::MMap> mmap;
 
+          // Block n holds the sparse data from offset (2^n - 1) * 2^block_bits, and is 2^(n + block_bits) bytes in size
+          // Space is reserved for the maximum number of blocks, so that the list is never moved, and can be
+          //   read without locking; only the allocation of new blocks requires the mutex
+          size_t block_bits;
+          std::vector<uint8_t*> blocks;
+          volatile size_t num_blocks;
+          Thread::Mutex mutex;
 
-          uint64_t size() const { return (mmap ? mmap->size() : 0); }
+
+          static size_t block_index (const uint64_t i, const size_t bits) { return 63 - __builtin_clzll ((i >> bits) + 1); }
+          static uint64_t block_start (const size_t n, const size_t bits) { return ((uint64_t(1) << n) - 1) << bits; }
 
           // Convert a file position offset (as read from the image data) to a pointer to the relevant sparsely-stored data
-          uint8_t* off2mem (const uint64_t i) const { assert (mmap); return (mmap->address() + i); }
+          uint8_t* off2mem (const uint64_t i) const
+          {
+            if (mmap)
+              return mmap->address() + i;
+            const size_t n = block_index (i, block_bits);
+            assert (n < num_blocks);
+            return blocks[n] + (i - block_start (n, block_bits));
+          }
+
+          // Reserve space for new sparse data of the requested size, and return its offset
+          uint64_t allocate (const uint64_t);
+          // Make sure all blocks up to and including block n have been allocated
+          void allocate_blocks (const size_t);
+          void free_blocks ();
 
 
       };
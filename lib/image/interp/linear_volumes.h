@@ -0,0 +1,183 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __image_interp_linear_volumes_h__
+#define __image_interp_linear_volumes_h__
+
+#include <cstring>
+
+#include "image/interp/linear.h"
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Interp
+    {
+
+      //! \cond skip
+      namespace
+      {
+        // the number of volumes blended together by LinearVolumes::get(),
+        // held in one SIMD vector:
+        template <typename ValueType> class __Volumes;
+
+        template <> class __Volumes<float> {
+          public:
+            typedef float vector_type __attribute__ ((vector_size (32)));
+            static const size_t size = 8;
+        };
+
+        template <> class __Volumes<double> {
+          public:
+            typedef double vector_type __attribute__ ((vector_size (32)));
+            static const size_t size = 4;
+        };
+      }
+      //! \endcond
+
+
+
+      //! \addtogroup interp
+      // @{
+
+      //! This class provides tri-linear interpolation of all volumes of a data set at once.
+      /*! The interpolation is identical to that of Interp::Linear, but the
+       * values for all volumes (i.e. along axis 3) at the current position
+       * are obtained with a single call to get(). This is intended for
+       * images held in RAM with the volumes of each voxel stored
+       * contiguously (i.e. with a stride of 1 along axis 3, as for an
+       * Image::BufferPreload requested with such strides): the interpolation
+       * weights are then only computed once per position, and the
+       * neighbouring voxels are blended as contiguous vectors rather than one
+       * value at a time. The offsets to the 8 neighbouring voxels are
+       * computed once on construction, so moving to a new position only
+       * requires looking up the address of the current voxel. For any other
+       * layout, get() falls back to interpolating each volume in turn.
+       *
+       * For example:
+       * \code
+       * std::vector<ssize_t> strides (4, 0);
+       * strides[3] = 1;
+       * Image::BufferPreload<float> buffer (argument[0], strides);
+       * Image::BufferPreload<float>::voxel_type voxel (buffer);
+       *
+       * Image::Interp::LinearVolumes<Image::BufferPreload<float>::voxel_type> interp (voxel);
+       * std::vector<float> values (interp.dim(3));
+       *
+       * interp.scanner (Point<float> (10.2, 3.59, 54.1));
+       * if (!(!interp))
+       *   interp.get (&values[0]);
+       * \endcode
+       *
+       * In addition to the requirements of Interp::Linear, the template \a
+       * VoxelType class must provide the RAM address of the current voxel
+       * via address(), and its stride along each axis via stride(). */
+      template <class VoxelType>
+        class LinearVolumes : public Linear<VoxelType>
+      {
+        public:
+          typedef typename VoxelType::value_type value_type;
+
+          using Linear<VoxelType>::dim;
+
+          LinearVolumes (const VoxelType& parent, value_type value_when_out_of_bounds = DataType::default_out_of_bounds_value<value_type>()) :
+            Linear<VoxelType> (parent, value_when_out_of_bounds),
+            contiguous (parent.ndim() == 4 && parent.stride (3) == 1)
+          {
+            // in the same order as the values are accumulated by Linear::value():
+            const ssize_t s0 = parent.stride (0), s1 = parent.stride (1), s2 = parent.stride (2);
+            offsets[0] = 0;
+            offsets[1] = s2;
+            offsets[2] = s1 + s2;
+            offsets[3] = s1;
+            offsets[4] = s0 + s1;
+            offsets[5] = s0;
+            offsets[6] = s0 + s2;
+            offsets[7] = s0 + s1 + s2;
+          }
+
+          //! get the interpolated values for all volumes at the current position
+          /*! \a values must have room for dim(3) entries. */
+          void get (value_type* values) {
+            const size_t num = dim (3);
+            if (this->out_of_bounds) {
+              for (size_t n = 0; n < num; ++n)
+                values[n] = this->out_of_bounds_value;
+              return;
+            }
+
+            if (!contiguous) {
+              for ((*this)[3] = 0; (*this)[3] < dim (3); ++(*this)[3])
+                values[(*this)[3]] = Linear<VoxelType>::value();
+              (*this)[3] = 0;
+              return;
+            }
+
+            // neighbours with zero weight are skipped, as in Linear::value():
+            // these may lie outside the image
+            const float weights[8] = { this->faaa, this->faab, this->fabb, this->faba, this->fbba, this->fbaa, this->fbab, this->fbbb };
+            const value_type* const base = VoxelType::address() - ssize_t ((*this)[3]);
+            const value_type* p[8];
+            value_type w[8];
+            size_t nw = 0;
+            for (size_t i = 0; i < 8; ++i) {
+              if (weights[i]) {
+                p[nw] = base + offsets[i];
+                w[nw++] = weights[i];
+              }
+            }
+
+            typedef typename __Volumes<value_type>::vector_type vector_type;
+            const size_t size = __Volumes<value_type>::size;
+            size_t n = 0;
+            for (; n + size <= num; n += size) {
+              vector_type sum, v;
+              memcpy (&sum, p[0]+n, sizeof (vector_type));
+              sum *= w[0];
+              for (size_t i = 1; i < nw; ++i) {
+                memcpy (&v, p[i]+n, sizeof (vector_type));
+                sum += w[i] * v;
+              }
+              memcpy (values+n, &sum, sizeof (vector_type));
+            }
+            for (; n < num; ++n) {
+              value_type sum = w[0] * p[0][n];
+              for (size_t i = 1; i < nw; ++i)
+                sum += w[i] * p[i][n];
+              values[n] = sum;
+            }
+          }
+
+        protected:
+          const bool contiguous;
+          ssize_t offsets[8];
+      };
+
+      //! @}
+
+    }
+  }
+}
+
+#endif
+
@@ -24,6 +24,7 @@
 #define __image_threaded_copy_h__
 
 #include "image/threaded_loop.h"
+#include "image/bulk_copy.h"
 
 namespace MR
 {
@@ -52,6 +53,8 @@ namespace MR
           const std::vector<size_t>& axes,
           size_t num_axes_in_thread = 1) 
       {
+        if (__bulk_copy (source, destination, axes, std::string(), true))
+          return;
         ThreadedLoop (source, axes, num_axes_in_thread)
           .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
       }
@@ -64,6 +67,8 @@ namespace MR
           size_t from_axis = 0, 
           size_t to_axis = std::numeric_limits<size_t>::max())
       {
+        if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), std::string(), true))
+          return;
         ThreadedLoop (source, num_axes_in_thread, from_axis, to_axis)
           .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
       }
@@ -79,6 +84,8 @@ namespace MR
           const std::vector<size_t>& axes,
           size_t num_axes_in_thread = 1)
       {
+        if (__bulk_copy (source, destination, axes, message, true))
+          return;
         ThreadedLoop (message, source, axes, num_axes_in_thread)
           .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
       }
@@ -92,6 +99,8 @@ namespace MR
           size_t from_axis = 0, 
           size_t to_axis = std::numeric_limits<size_t>::max())
       {
+        if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), message, true))
+          return;
         ThreadedLoop (message, source, num_axes_in_thread, from_axis, to_axis)
           .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
       }
@@ -120,6 +129,49 @@ namespace MR
             source, destination, num_axes_in_thread, from_axis, to_axis);
       }
 
+
+
+
+    //! multi-threaded copy, traversing the outer loop in tiles
+    /*! This is intended for use with adapters that access a neighbourhood
+     * around each voxel (e.g. Adapter::Median3D, Adapter::Gaussian1D): by
+     * processing compact tiles of the outer loop in each thread, neighbouring
+     * voxels are more likely to still reside in the CPU cache when they are
+     * re-used. The \a tile extent is indexed by image axis; see
+     * ThreadedLoop::set_tile() for details. */
+    template <class InputVoxelType, class OutputVoxelType>
+      inline void threaded_copy_tiled (
+          InputVoxelType& source, 
+          OutputVoxelType& destination, 
+          const std::vector<size_t>& tile,
+          size_t num_axes_in_thread = 1, 
+          size_t from_axis = 0, 
+          size_t to_axis = std::numeric_limits<size_t>::max())
+      {
+        if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), std::string(), true))
+          return;
+        ThreadedLoop (source, num_axes_in_thread, from_axis, to_axis)
+          .set_tile (tile)
+          .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
+      }
+
+    template <class InputVoxelType, class OutputVoxelType>
+      inline void threaded_copy_tiled_with_progress_message (
+          const std::string& message, 
+          InputVoxelType& source, 
+          OutputVoxelType& destination, 
+          const std::vector<size_t>& tile,
+          size_t num_axes_in_thread = 1, 
+          size_t from_axis = 0, 
+          size_t to_axis = std::numeric_limits<size_t>::max())
+      {
+        if (__bulk_copy (source, destination, __axes (source, from_axis, to_axis), message, true))
+          return;
+        ThreadedLoop (message, source, num_axes_in_thread, from_axis, to_axis)
+          .set_tile (tile)
+          .run (__copy<InputVoxelType, OutputVoxelType>, source, destination);
+      }
+
   }
 }
 
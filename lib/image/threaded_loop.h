@@ -24,11 +24,17 @@
 #define __image_threaded_loop_h__
 
 #include "debug.h"
+#include "progressbar.h"
 #include "image/loop.h"
 #include "image/iterator.h"
 #include "thread/mutex.h"
 #include "thread/exec.h"
 
+// the minimum number of voxels to be processed per chunk of the outer loop
+#define MRTRIX_THREADED_LOOP_MIN_CHUNK_VOXELS 4096
+// each thread aims to receive around this many chunks over the whole loop
+#define MRTRIX_THREADED_LOOP_CHUNKS_PER_THREAD 4
+
 namespace MR
 {
 
@@ -166,6 +172,31 @@ namespace MR
      *
      *
      *
+     * \section threaded_loop_scheduling Scheduling and tiling
+     *
+     * Positions in the outer loop are not handed out to the threads one at a
+     * time, but in chunks of consecutive positions claimed using a single
+     * atomic operation. The size of each chunk adapts to the work remaining:
+     * chunks are large at the start of the loop (to minimise the
+     * synchronisation overhead, particularly for small inner loops), and
+     * shrink towards the end of the loop so that the load remains balanced
+     * across threads. Each chunk will contain at least
+     * MRTRIX_THREADED_LOOP_MIN_CHUNK_VOXELS voxels where possible.
+     *
+     * By default, the outer loop is traversed in the usual order. For
+     * operations that access neighbouring voxels (e.g. the median or
+     * smoothing filters), the outer loop can instead be traversed in tiles
+     * using the set_tile() method, so that each thread processes a compact
+     * block of positions, and neighbouring data are more likely to still
+     * reside in the CPU cache when they are re-used. For example, to loop
+     * along rows, with the rows handed out in blocks of 8x8 in the y-z plane:
+     *
+     * \code
+     * std::vector<size_t> tile (3, 8);
+     * Image::ThreadedLoop (vox, 1, 0, 3).set_tile (tile).run (my_filter, vox_out);
+     * \endcode
+     *
+     *
      * \section threaded_loop_run The run() methods
      *
      * The run() methods will run the Image::ThreadedLoop, invoking the
@@ -286,6 +317,7 @@ namespace MR
             dummy (source),
             axes (axes_in_thread) {
               loop.start (dummy);
+              __init();
             }
 
         template <class InfoType>
@@ -297,6 +329,7 @@ namespace MR
             dummy (source),
             axes (__get_axes_in_thread (axes_in_loop, num_inner_axes)) {
               loop.start (dummy);
+              __init();
             }
 
         template <class InfoType>
@@ -309,6 +342,7 @@ namespace MR
             dummy (source),
             axes (__get_axes_in_thread (source, num_inner_axes, from_axis, to_axis)) {
               loop.start (dummy);
+              __init();
             }
 
         template <class InfoType>
@@ -317,10 +351,12 @@ namespace MR
               const InfoType& source,
               const std::vector<size_t>& axes_out_of_thread,
               const std::vector<size_t>& axes_in_thread) :
-            loop (axes_out_of_thread, progress_message),
+            loop (axes_out_of_thread),
             dummy (source),
-            axes (axes_in_thread) {
+            axes (axes_in_thread),
+            progress (progress_message, 1) {
               loop.start (dummy);
+              __init();
             }
 
         template <class InfoType>
@@ -329,10 +365,12 @@ namespace MR
               const InfoType& source,
               const std::vector<size_t>& axes_in_loop,
               size_t num_inner_axes = 1) :
-            loop (__get_axes_out_of_thread (axes_in_loop, num_inner_axes), progress_message),
+            loop (__get_axes_out_of_thread (axes_in_loop, num_inner_axes)),
             dummy (source),
-            axes (__get_axes_in_thread (axes_in_loop, num_inner_axes)) {
+            axes (__get_axes_in_thread (axes_in_loop, num_inner_axes)),
+            progress (progress_message, 1) {
               loop.start (dummy);
+              __init();
             }
 
         template <class InfoType>
@@ -342,10 +380,12 @@ namespace MR
               size_t num_inner_axes = 1,
               size_t from_axis = 0,
               size_t to_axis = std::numeric_limits<size_t>::max()) :
-            loop (__get_axes_out_of_thread (source, num_inner_axes, from_axis, to_axis), progress_message),
+            loop (__get_axes_out_of_thread (source, num_inner_axes, from_axis, to_axis)),
             dummy (source),
-            axes (__get_axes_in_thread (source, num_inner_axes, from_axis, to_axis)) {
+            axes (__get_axes_in_thread (source, num_inner_axes, from_axis, to_axis)),
+            progress (progress_message, 1) {
               loop.start (dummy);
+              __init();
             }
 
        
@@ -362,7 +402,66 @@ namespace MR
         //! a dummy object that can be used to construct other Iterators
         const Iterator& iterator () const { return dummy; }
 
+        //! traverse the outer loop in tiles of the specified \a extent
+        /*! \a extent is indexed by image axis, and specifies the size of the
+         * tile along that axis; entries corresponding to axes that are not
+         * part of the outer loop are ignored, and missing entries are taken
+         * to be 1. Each tile is processed in its entirety by the same thread.
+         * See \ref threaded_loop_scheduling for details. */
+        ThreadedLoop& set_tile (const std::vector<size_t>& extent) {
+          for (size_t i = 0; i < tile.size(); ++i) {
+            const size_t axis = outer_axes()[i];
+            tile[i] = axis < extent.size() ? std::max (extent[axis], size_t (1)) : 1;
+          }
+          __update_tiles();
+          return *this;
+        }
+
+        //! claim the next chunk of tiles in the outer loop
+        /*! On success, the tiles with indices from \a first up to (but not
+         * including) \a last are reserved for the calling thread. Use
+         * get_tile() to obtain the extent of each tile. */
+        bool next_chunk (size_t& first, size_t& last) {
+          size_t current = next_tile;
+          while (current < total_tiles) {
+            const size_t remaining = total_tiles - current;
+            size_t grain = remaining / (MRTRIX_THREADED_LOOP_CHUNKS_PER_THREAD * num_threads);
+            grain = std::min (std::max (grain, min_grain), remaining);
+            const size_t previous = __sync_val_compare_and_swap (&next_tile, current, current + grain);
+            if (previous == current) {
+              first = current;
+              last = current + grain;
+              return true;
+            }
+            current = previous;
+          }
+          return false;
+        }
+
+        //! get the range of positions covered by tile \a index
+        /*! on return, \a from and \a to hold the (inclusive) start and
+         * (exclusive) end positions of the tile along each outer axis. */
+        void get_tile (size_t index, std::vector<ssize_t>& from, std::vector<ssize_t>& to) const {
+          for (size_t i = 0; i < tile.size(); ++i) {
+            from[i] = (index % num_tiles[i]) * tile[i];
+            to[i] = std::min (from[i] + ssize_t (tile[i]), dummy.dim (outer_axes()[i]));
+            index /= num_tiles[i];
+          }
+        }
+
+        //! update the progress bar (if any) after processing \a count outer positions
+        void update_progress (size_t count) {
+          if (!progress) 
+            return;
+          Thread::Mutex::Lock lock (mutex);
+          while (count--)
+            ++progress;
+        }
+
         //! get next position in the outer loop
+        /*! \note this hands out positions one at a time, and is retained for
+         * backwards compatibility only: the run() and run_outer() methods use
+         * next_chunk() instead. */
         bool next (Iterator& pos) {
           Thread::Mutex::Lock lock (mutex);
           if (loop.ok()) {
@@ -398,8 +497,41 @@ namespace MR
         LoopInOrder loop;
         Iterator dummy;
         const std::vector<size_t> axes;
+        ProgressBar progress;
         Thread::Mutex mutex;
 
+        std::vector<size_t> tile, num_tiles;
+        size_t total_tiles, min_grain, num_threads;
+        volatile size_t next_tile;
+
+        void __init () {
+          tile.assign (outer_axes().size(), 1);
+          num_threads = std::max (Thread::number_of_threads(), size_t (1));
+          __update_tiles();
+          if (progress) {
+            size_t count = 1;
+            for (size_t i = 0; i < outer_axes().size(); ++i) 
+              count *= dummy.dim (outer_axes()[i]);
+            if (count) 
+              progress.set_max (count);
+          }
+        }
+
+        void __update_tiles () {
+          num_tiles.resize (tile.size());
+          total_tiles = 1;
+          size_t tile_voxels = 1;
+          for (size_t i = 0; i < tile.size(); ++i) {
+            num_tiles[i] = (dummy.dim (outer_axes()[i]) + tile[i] - 1) / tile[i];
+            total_tiles *= num_tiles[i];
+            tile_voxels *= tile[i];
+          }
+          for (size_t i = 0; i < inner_axes().size(); ++i)
+            tile_voxels *= dummy.dim (inner_axes()[i]);
+          min_grain = std::max (MRTRIX_THREADED_LOOP_MIN_CHUNK_VOXELS / std::max (tile_voxels, size_t (1)), size_t (1));
+          next_tile = 0;
+        }
+
         static std::vector<size_t> __get_axes_in_thread (
             const std::vector<size_t>& axes_in_loop,
             size_t num_inner_axes) {
@@ -448,8 +580,30 @@ namespace MR
 
              void execute () {
                Iterator pos (shared.iterator());
-               while (shared.next (pos))
-                 func (pos);
+               const std::vector<size_t>& axes (shared.outer_axes());
+               std::vector<ssize_t> from (axes.size()), to (axes.size());
+               size_t first, last;
+               while (shared.next_chunk (first, last)) {
+                 size_t count = 0;
+                 for (size_t t = first; t < last; ++t) {
+                   shared.get_tile (t, from, to);
+                   for (size_t i = 0; i < axes.size(); ++i) 
+                     pos[axes[i]] = from[i];
+                   while (true) {
+                     func (pos);
+                     ++count;
+                     size_t i = 0;
+                     for (; i < axes.size(); ++i) {
+                       if (++pos[axes[i]] < to[i]) 
+                         break;
+                       pos[axes[i]] = from[i];
+                     }
+                     if (i == axes.size()) 
+                       break;
+                   }
+                 }
+                 shared.update_progress (count);
+               }
              }
 
            protected:
@@ -560,8 +714,10 @@ namespace MR
        inline void ThreadedLoop::run_outer (Functor functor, const std::string& thread_label)
        {
          if (Thread::number_of_threads() == 0) {
-           for (loop.start (dummy); loop.ok(); loop.next (dummy)) 
+           for (loop.start (dummy); loop.ok(); loop.next (dummy)) {
              functor (dummy);
+             ++progress;
+           }
            return;
          }
 
@@ -581,6 +737,7 @@ namespace MR
            for (loop.start (dummy); loop.ok(); loop.next (dummy)) {
              for (inner_loop.start (dummy); inner_loop.ok(); inner_loop.next (dummy))
                functor (dummy);
+             ++progress;
            }
            return;
          }
@@ -598,6 +755,7 @@ namespace MR
            for (loop.start (vox1); loop.ok(); loop.next (vox1)) {
              for (inner_loop.start (vox1); inner_loop.ok(); inner_loop.next (vox1))
                functor (vox1);
+             ++progress;
            }
            return;
          }
@@ -617,6 +775,7 @@ namespace MR
            for (loop.start (vox1, vox2); loop.ok(); loop.next (vox1, vox2)) {
              for (inner_loop.start (vox1, vox2); inner_loop.ok(); inner_loop.next (vox1, vox2))
                functor (vox1, vox2);
+             ++progress;
            }
            return;
          }
@@ -636,6 +795,7 @@ namespace MR
            for (loop.start (vox1, vox2, vox3); loop.ok(); loop.next (vox1, vox2, vox3)) {
              for (inner_loop.start (vox1, vox2, vox3); inner_loop.ok(); inner_loop.next (vox1, vox2, vox3))
                functor (vox1, vox2, vox3);
+             ++progress;
            }
            return;
          }
@@ -0,0 +1,180 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstdlib>
+#include <climits>
+#include <typeinfo>
+
+#include "file/ofstream.h"
+#include "file/path.h"
+#include "image/virtual.h"
+#include "image/stride.h"
+#include "image/utils.h"
+#include "image/handler/default.h"
+#include "image/format/mrtrix_utils.h"
+
+namespace MR
+{
+  namespace Image
+  {
+    namespace Virtual
+    {
+
+      //! \cond skip
+      namespace
+      {
+        inline int64_t gcd (int64_t a, int64_t b)
+        {
+          while (b) {
+            const int64_t t = a % b;
+            a = b;
+            b = t;
+          }
+          return a;
+        }
+
+        // virtual images may be stored anywhere, so must refer to their
+        // data using absolute paths:
+        inline std::string absolute_path (const std::string& filename)
+        {
+#ifdef MRTRIX_WINDOWS
+          char path [_MAX_PATH];
+          if (!_fullpath (path, filename.c_str(), _MAX_PATH))
+            throw Exception ("unable to determine full path of file \"" + filename + "\"");
+          return path;
+#else
+          char* path = realpath (filename.c_str(), NULL);
+          if (!path)
+            throw Exception ("unable to determine full path of file \"" + filename + "\": " + strerror (errno));
+          std::string ret (path);
+          free (path);
+          return ret;
+#endif
+        }
+      }
+      //! \endcond
+
+
+
+
+      Slabs::Slabs (const Header& header) :
+        outer_axis (0),
+        num_slabs (0),
+        slab_bytes (0),
+        segment_bytes (0),
+        reversed (false)
+      {
+        const RefPtr<Handler::Base> handler (header.__get_handler());
+        // only plain files can be copied raw: handlers derived from Default
+        //   (such as Sparse) hold data elsewhere that the raw copy would miss
+        if (!handler || typeid (*handler) != typeid (Handler::Default) || handler->files.empty())
+          return;
+
+        // singleton axes have no influence on the order of the data:
+        const std::vector<ssize_t> strides (Stride::get_actual (const_cast<Header&> (header)));
+        bool found = false;
+        for (size_t n = 0; n < header.ndim(); ++n) {
+          if (header.dim (n) > 1 && (!found || std::abs (strides[n]) > std::abs (strides[outer_axis]))) {
+            outer_axis = n;
+            found = true;
+          }
+        }
+
+        num_slabs = header.dim (outer_axis);
+        const int64_t voxels_per_slab = voxel_count (header) / num_slabs;
+        const int64_t voxels_per_segment = voxel_count (header) / handler->files.size();
+        // bitwise data can only be split along byte boundaries:
+        if (header.datatype().bits() == 1 && (voxels_per_slab % 8 || voxels_per_segment % 8))
+          return;
+
+        files = handler->files;
+        segment_bytes = footprint (voxels_per_segment, header.datatype());
+        slab_bytes = footprint (voxels_per_slab, header.datatype());
+        reversed = strides[outer_axis] < 0;
+      }
+
+
+
+
+      void Slabs::append (size_t index, RangeList& ranges) const
+      {
+        assert (valid());
+        assert (index < num_slabs);
+        if (reversed)
+          index = num_slabs - 1 - index;
+
+        // a slab may span several files, or only part of one:
+        int64_t begin = index * slab_bytes;
+        const int64_t end = begin + slab_bytes;
+        while (begin < end) {
+          const size_t n = begin / segment_bytes;
+          const int64_t offset = begin - n * segment_bytes;
+          const int64_t bytes = std::min (end - begin, segment_bytes - offset);
+          ranges.append (Range (files[n].name, files[n].start + offset, bytes));
+          begin += bytes;
+        }
+      }
+
+
+
+
+      bool supported (const std::string& image_name)
+      {
+        return Path::has_suffix (image_name, ".mif") || Path::has_suffix (image_name, ".mih");
+      }
+
+
+
+
+      void create (const Header& header, const RangeList& ranges)
+      {
+        if (!supported (header.name()))
+          throw Exception ("virtual image \"" + header.name() + "\" must be stored in MRtrix format (.mif or .mih)");
+
+        // all files in the image must hold the same amount of data, so split
+        // the ranges into the largest entries that allow this:
+        int64_t total = 0, entry_bytes = 0;
+        for (size_t n = 0; n < ranges.size(); ++n) {
+          total += ranges[n].bytes;
+          entry_bytes = gcd (entry_bytes, ranges[n].bytes);
+        }
+        if (total != footprint (header))
+          throw Exception ("data provided do not match dimensions of virtual image \"" + header.name() + "\"");
+
+        File::OFStream out (header.name(), std::ios::out | std::ios::binary);
+        out << "mrtrix image\n";
+        Format::write_mrtrix_header (header, out);
+        size_t count = 0;
+        for (size_t n = 0; n < ranges.size(); ++n) {
+          const std::string filename (absolute_path (ranges[n].name));
+          for (int64_t offset = 0; offset < ranges[n].bytes; offset += entry_bytes, ++count)
+            out << "file: " << filename << " " << ranges[n].start + offset << "\n";
+        }
+        out << "END\n";
+
+        INFO ("created virtual image \"" + header.name() + "\" referencing " + str (count) + " entries of " + str (entry_bytes) + " bytes");
+      }
+
+    }
+  }
+}
+
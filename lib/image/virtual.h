@@ -0,0 +1,122 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __image_virtual_h__
+#define __image_virtual_h__
+
+#include <vector>
+
+#include "types.h"
+#include "file/entry.h"
+#include "image/header.h"
+
+namespace MR
+{
+  namespace Image
+  {
+
+    //! functions and classes to create header-only views of existing images
+    /*! A virtual image is an MRtrix format image header whose data are held
+     * in (parts of) the files of other images, so that images can be
+     * reorganised (e.g. volumes extracted, axes permuted, or images
+     * concatenated) without copying any data. These images will only remain
+     * valid for as long as the files they refer to remain unchanged. */
+    namespace Virtual
+    {
+
+      //! a contiguous range of bytes within a file
+      class Range
+      {
+        public:
+          Range (const std::string& filename, int64_t offset, int64_t size) :
+            name (filename), start (offset), bytes (size) { }
+
+          std::string name;
+          int64_t start, bytes;
+      };
+
+
+
+      //! the data of an image, as a list of contiguous byte ranges in order
+      class RangeList : public std::vector<Range>
+      {
+        public:
+          //! append \a range, merging it with the last if contiguous
+          void append (const Range& range) {
+            if (size() && back().name == range.name && back().start + back().bytes == range.start)
+              back().bytes += range.bytes;
+            else
+              push_back (range);
+          }
+      };
+
+
+
+      //! the data of an existing image, as slabs along its outermost axis
+      /*! Each slab holds the data for one position along the non-singleton
+       * axis of largest stride, which will be stored contiguously. This is only
+       * possible for images whose data are stored uncompressed in one or
+       * more files (i.e. those accessed via Handler::Default): check valid()
+       * before use. */
+      class Slabs
+      {
+        public:
+          Slabs (const Header& header);
+
+          bool valid () const {
+            return slab_bytes;
+          }
+          //! the outermost axis of the image
+          size_t axis () const {
+            return outer_axis;
+          }
+          //! the number of slabs (i.e. the dimension of the outermost axis)
+          size_t size () const {
+            return num_slabs;
+          }
+
+          //! append the data for position \a index along the outermost axis to \a ranges
+          void append (size_t index, RangeList& ranges) const;
+
+        protected:
+          std::vector<File::Entry> files;
+          size_t outer_axis, num_slabs;
+          int64_t slab_bytes, segment_bytes;
+          bool reversed;
+      };
+
+
+
+      //! create image \a header as a header-only MRtrix image, with its data held in \a ranges
+      /*! The strides of \a header should ensure the data in \a ranges are
+       * stored in the order listed. */
+      void create (const Header& header, const RangeList& ranges);
+
+      //! whether \a image_name refers to a format that can hold a virtual image
+      bool supported (const std::string& image_name);
+
+    }
+  }
+}
+
+#endif
+
@@ -97,6 +97,17 @@ namespace MR
             return Image::Value<Voxel> (*this);
           }
 
+          //! read the \a count values stored contiguously from the current voxel onwards
+          /*! \note this will only work with Image::Buffer and derived classes. */
+          void get_values (value_type* values, size_t count) const {
+            data_.get_values (offset_, values, count);
+          }
+          //! write \a count values to be stored contiguously from the current voxel onwards
+          /*! \note this will only work with Image::Buffer and derived classes. */
+          void set_values (const value_type* values, size_t count) {
+            data_.set_values (offset_, values, count);
+          }
+
           //! return RAM address of current voxel
           /*! \note this will only work with Image::BufferPreload and
            * Image::BufferScratch. */
@@ -433,6 +433,27 @@ namespace MR
           typename std::vector<ValueType>::const_iterator p1, p2;
       };
 
+      //! \cond skip
+      namespace
+      {
+        // the number of directions evaluated together by
+        // PrecomputedAL::value(), held in one SIMD vector:
+        template <typename ValueType> class __Batch;
+
+        template <> class __Batch<float> {
+          public:
+            typedef float vector_type __attribute__ ((vector_size (32)));
+            static const size_t size = 8;
+        };
+
+        template <> class __Batch<double> {
+          public:
+            typedef double vector_type __attribute__ ((vector_size (32)));
+            static const size_t size = 4;
+        };
+      }
+      //! \endcond
+
 #ifndef USE_NON_ORTHONORMAL_SH_BASIS
 #define SH_NON_M0_SCALE_FACTOR (m?M_SQRT2:1.0)*
 #else
@@ -537,6 +558,76 @@ namespace MR
               return v;
             }
 
+          //! evaluate the SH series \a val along each of \a num directions at once
+          /*! The amplitude along \a unit_dirs[n] is stored in \a amplitudes[n].
+           * Directions are processed in batches, with the interpolated
+           * associated Legendre functions and azimuthal terms for each
+           * batch held in structure-of-arrays layout, so that the
+           * summation over the SH series proceeds on all directions of the
+           * batch at once using SIMD instructions. */
+          template <class ValueContainer>
+            void value (ValueType* amplitudes, const ValueContainer& val, const Point<ValueType>* unit_dirs, size_t num) const {
+              typedef typename __Batch<ValueType>::vector_type vector_type;
+              const size_t W = __Batch<ValueType>::size;
+              VLA_MAX (AL, vector_type, nAL, 256);
+
+              for (size_t start = 0; start < num; start += W) {
+                const size_t n = std::min (W, num-start);
+                const ValueType* p1[W];
+                const ValueType* p2[W];
+                vector_type f1, f2, cp, sp, c0, s0, v;
+
+                for (size_t j = 0; j < W; ++j) {
+                  // pad the last batch by repeating its last direction:
+                  const Point<ValueType>& d (unit_dirs[start + std::min (j, n-1)]);
+                  PrecomputedFraction<ValueType> f;
+                  set (f, Math::acos (d[2]));
+                  f1[j] = f.f1;
+                  f2[j] = f.f2;
+                  p1[j] = &f.p1[0];
+                  p2[j] = f.f2 ? &f.p2[0] : p1[j];
+                  ValueType rxy = Math::sqrt ( Math::pow2(d[1]) + Math::pow2(d[0]) );
+                  cp[j] = (rxy) ? d[0]/rxy : 1.0;
+                  sp[j] = (rxy) ? d[1]/rxy : 0.0;
+                  c0[j] = 1.0;
+                  s0[j] = v[j] = 0.0;
+                }
+
+                for (int i = 0; i < nAL; ++i) {
+                  ValueType a1[W], a2[W];
+                  for (size_t j = 0; j < W; ++j) {
+                    a1[j] = p1[j][i];
+                    a2[j] = p2[j][i];
+                  }
+                  vector_type v1, v2;
+                  memcpy (&v1, a1, sizeof (vector_type));
+                  memcpy (&v2, a2, sizeof (vector_type));
+                  AL[i] = f1 * v1 + f2 * v2;
+                }
+
+                for (int l = 0; l <= lmax; l+=2)
+                  v += ValueType (val[index (l,0)]) * AL[index_mpos (l,0)];
+                for (int m = 1; m <= lmax; m++) {
+                  vector_type c = c0 * cp - s0 * sp;
+                  vector_type s = s0 * cp + c0 * sp;
+                  for (int l = ( (m&1) ? m+1 : m); l <= lmax; l+=2)
+                    v += AL[index_mpos (l,m)] * (ValueType (val[index (l,m)]) * c + ValueType (val[index (l,-m)]) * s);
+                  c0 = c;
+                  s0 = s;
+                }
+
+                for (size_t j = 0; j < n; ++j)
+                  amplitudes[start+j] = v[j];
+              }
+            }
+
+          template <class ValueContainer>
+            void value (std::vector<ValueType>& amplitudes, const ValueContainer& val, const std::vector< Point<ValueType> >& unit_dirs) const {
+              amplitudes.resize (unit_dirs.size());
+              if (unit_dirs.size())
+                value (&amplitudes[0], val, &unit_dirs[0], unit_dirs.size());
+            }
+
         protected:
           int lmax, ndir, nAL;
           ValueType inc;
@@ -0,0 +1,272 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __math_gemm_h__
+#define __math_gemm_h__
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+// the depth of the panels of A and B held in cache at any one time:
+#define MRTRIX_GEMM_KC 256
+// the number of rows of A held in cache at any one time:
+#define MRTRIX_GEMM_MC 96
+// the number of columns of B held in cache at any one time:
+#define MRTRIX_GEMM_NC 4096
+
+namespace MR
+{
+  namespace Math
+  {
+
+    //! a cache-blocked, register-tiled implementation of matrix multiplication
+    /*! This provides an alternative to the reference C BLAS routines
+     * supplied with the GSL for the matrix-matrix products in Math::mult()
+     * and Math::rankN_update(), for single and double precision data. It
+     * is used in their place if MRtrix is configured with the -gemm option
+     * (which defines MRTRIX_BUNDLED_GEMM). Alternatively, an optimised
+     * external C BLAS library (e.g. OpenBLAS) can be used by setting the
+     * CBLAS_LDFLAGS environment variable when running configure. The
+     * gemmbench command can be used to compare the two.
+     *
+     * The implementation follows the approach used in GotoBLAS & BLIS: the
+     * operands are copied in blocks into contiguous buffers sized to remain
+     * in cache, in the order in which they will be accessed by a micro-kernel
+     * that accumulates a small tile of the product in registers, using the
+     * SIMD vector extensions of the compiler.
+     *
+     * All matrices are stored in row-major order, with rows separated by
+     * the strides given (as for Math::Matrix). */
+    namespace GEMM
+    {
+
+      //! which part of the product should be computed
+      typedef enum {
+        Full,
+        Lower, /**< only the lower triangle, including the diagonal */
+        Upper  /**< only the upper triangle, including the diagonal */
+      } Triangle;
+
+
+      //! \cond skip
+      namespace
+      {
+
+        // the size of the tile held in registers: MR rows, by NR columns held
+        // in one vector register each:
+        template <typename ValueType> class Tile;
+
+        template <> class Tile<float> {
+          public:
+            typedef float vector_type __attribute__ ((vector_size (32)));
+            static const size_t MR = 8, NR = 8;
+        };
+
+        template <> class Tile<double> {
+          public:
+            typedef double vector_type __attribute__ ((vector_size (64)));
+            static const size_t MR = 4, NR = 8;
+        };
+
+
+        inline bool __in_triangle (Triangle triangle, size_t i, size_t j)
+        {
+          return triangle == Full || (triangle == Lower ? j <= i : i <= j);
+        }
+
+
+        // copy rows [i0,i0+m) and columns [k0,k0+k) of op(A) into strips of
+        // MR rows, each stored column by column:
+        template <typename ValueType>
+          inline void __pack_A (ValueType* packed, const ValueType* A, size_t lda, bool trans,
+              size_t i0, size_t m, size_t k0, size_t k)
+          {
+            const size_t MR = Tile<ValueType>::MR;
+            for (size_t i = 0; i < m; i += MR) {
+              const size_t mr = std::min (MR, m-i);
+              for (size_t p = 0; p < k; ++p, packed += MR) {
+                size_t r = 0;
+                if (trans) {
+                  const ValueType* a = A + (k0+p)*lda + i0+i;
+                  for (; r < mr; ++r)
+                    packed[r] = a[r];
+                }
+                else {
+                  const ValueType* a = A + (i0+i)*lda + k0+p;
+                  for (; r < mr; ++r)
+                    packed[r] = a[r*lda];
+                }
+                for (; r < MR; ++r)
+                  packed[r] = 0.0;
+              }
+            }
+          }
+
+
+        // copy rows [k0,k0+k) and columns [j0,j0+n) of op(B) into strips of
+        // NR columns, each stored row by row:
+        template <typename ValueType>
+          inline void __pack_B (ValueType* packed, const ValueType* B, size_t ldb, bool trans,
+              size_t k0, size_t k, size_t j0, size_t n)
+          {
+            const size_t NR = Tile<ValueType>::NR;
+            for (size_t j = 0; j < n; j += NR) {
+              const size_t nr = std::min (NR, n-j);
+              for (size_t p = 0; p < k; ++p, packed += NR) {
+                size_t c = 0;
+                if (trans) {
+                  const ValueType* b = B + (j0+j)*ldb + k0+p;
+                  for (; c < nr; ++c)
+                    packed[c] = b[c*ldb];
+                }
+                else {
+                  const ValueType* b = B + (k0+p)*ldb + j0+j;
+                  for (; c < nr; ++c)
+                    packed[c] = b[c];
+                }
+                for (; c < NR; ++c)
+                  packed[c] = 0.0;
+              }
+            }
+          }
+
+
+        // acc[r] += a[r] * b for r in [0,R), unrolled explicitly so that the
+        // accumulators remain in registers:
+        template <size_t R> class __Accumulate {
+          public:
+            template <typename ValueType, typename VectorType>
+              static inline void run (VectorType* acc, const ValueType* a, const VectorType& b) {
+                __Accumulate<R-1>::run (acc, a, b);
+                acc[R-1] += a[R-1] * b;
+              }
+        };
+
+        template <> class __Accumulate<0> {
+          public:
+            template <typename ValueType, typename VectorType>
+              static inline void run (VectorType* acc, const ValueType* a, const VectorType& b) { }
+        };
+
+
+        // C[0:mr,0:nr] += alpha * (packed A strip) * (packed B strip), for
+        // the tile of C at row i0, column j0:
+        template <typename ValueType>
+          inline void __micro_kernel (size_t k, ValueType alpha, const ValueType* a, const ValueType* b,
+              ValueType* C, size_t ldc, size_t mr, size_t nr, Triangle triangle, size_t i0, size_t j0)
+          {
+            typedef typename Tile<ValueType>::vector_type vector_type;
+            const size_t MR = Tile<ValueType>::MR, NR = Tile<ValueType>::NR;
+
+            vector_type acc[MR];
+            for (size_t r = 0; r < MR; ++r)
+              for (size_t c = 0; c < NR; ++c)
+                acc[r][c] = 0.0;
+
+            for (size_t p = 0; p < k; ++p, a += MR, b += NR) {
+              vector_type bv;
+              memcpy (&bv, b, sizeof (vector_type));
+              __Accumulate<Tile<ValueType>::MR>::run (acc, a, bv);
+            }
+
+            for (size_t r = 0; r < mr; ++r) {
+              ValueType* c_row = C + (i0+r)*ldc + j0;
+              for (size_t c = 0; c < nr; ++c)
+                if (__in_triangle (triangle, i0+r, j0+c))
+                  c_row[c] += alpha * acc[r][c];
+            }
+          }
+
+      }
+      //! \endcond
+
+
+
+      //! compute C = alpha op(A) op(B) + beta C
+      /*! where op(A) is an \a M x \a K matrix, op(B) is a \a K x \a N
+       * matrix, and C is \a M x \a N. If \a triangle is not Full, C must be
+       * square, and only the triangle specified will be computed (as for
+       * the syrk BLAS routine); other elements remain untouched. */
+      template <typename ValueType>
+        void gemm (bool trans_A, bool trans_B, size_t M, size_t N, size_t K,
+            ValueType alpha, const ValueType* A, size_t lda, const ValueType* B, size_t ldb,
+            ValueType beta, ValueType* C, size_t ldc, Triangle triangle = Full)
+        {
+          const size_t MR = Tile<ValueType>::MR, NR = Tile<ValueType>::NR;
+
+          if (beta != 1.0) {
+            for (size_t i = 0; i < M; ++i) {
+              for (size_t j = 0; j < N; ++j) {
+                if (__in_triangle (triangle, i, j)) {
+                  ValueType& c (C[i*ldc+j]);
+                  c = beta == 0.0 ? ValueType (0.0) : beta * c;
+                }
+              }
+            }
+          }
+          if (!M || !N || !K || alpha == 0.0)
+            return;
+
+          const size_t kc_max = std::min (K, size_t (MRTRIX_GEMM_KC));
+          const size_t mc_max = std::min (M, size_t (MRTRIX_GEMM_MC));
+          const size_t nc_max = std::min (N, size_t (MRTRIX_GEMM_NC));
+          std::vector<ValueType> packed_A (kc_max * (mc_max + MR - 1) / MR * MR);
+          std::vector<ValueType> packed_B (kc_max * (nc_max + NR - 1) / NR * NR);
+
+          for (size_t jc = 0; jc < N; jc += MRTRIX_GEMM_NC) {
+            const size_t nc = std::min (N-jc, size_t (MRTRIX_GEMM_NC));
+
+            for (size_t pc = 0; pc < K; pc += MRTRIX_GEMM_KC) {
+              const size_t kc = std::min (K-pc, size_t (MRTRIX_GEMM_KC));
+              __pack_B (&packed_B[0], B, ldb, trans_B, pc, kc, jc, nc);
+
+              for (size_t ic = 0; ic < M; ic += MRTRIX_GEMM_MC) {
+                const size_t mc = std::min (M-ic, size_t (MRTRIX_GEMM_MC));
+                // blocks of a triangular product lying entirely outside the
+                // triangle need not be computed:
+                if ((triangle == Lower && jc > ic+mc-1) || (triangle == Upper && ic > jc+nc-1))
+                  continue;
+                __pack_A (&packed_A[0], A, lda, trans_A, ic, mc, pc, kc);
+
+                for (size_t jr = 0; jr < nc; jr += NR) {
+                  const size_t nr = std::min (NR, nc-jr);
+                  for (size_t ir = 0; ir < mc; ir += MR) {
+                    const size_t mr = std::min (MR, mc-ir);
+                    const size_t i0 = ic+ir, j0 = jc+jr;
+                    if ((triangle == Lower && j0 > i0+mr-1) || (triangle == Upper && i0 > j0+nr-1))
+                      continue;
+                    __micro_kernel (kc, alpha, &packed_A[ir*kc], &packed_B[jr*kc],
+                        C, ldc, mr, nr, triangle, i0, j0);
+                  }
+                }
+              }
+            }
+          }
+        }
+
+    }
+  }
+}
+
+#endif
+
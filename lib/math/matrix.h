@@ -33,6 +33,7 @@
 #include "file/ofstream.h"
 #include "math/math.h"
 #include "math/vector.h"
+#include "math/gemm.h"
 
 #ifdef __math_complex_h__
 #include <gsl/gsl_matrix_complex_double.h>
@@ -730,11 +731,42 @@ namespace MR
 
     namespace
     {
+#ifdef MRTRIX_BUNDLED_GEMM
+      // real-valued matrix products via the bundled implementation:
+
+      template <typename ValueType>
+        inline void __gemm (CBLAS_TRANSPOSE op_A, CBLAS_TRANSPOSE op_B, ValueType alpha, const Matrix<ValueType>& A, const Matrix<ValueType>& B, ValueType beta, Matrix<ValueType>& C)
+        {
+          const bool trans_A = op_A != CblasNoTrans, trans_B = op_B != CblasNoTrans;
+          const size_t K = trans_A ? A.rows() : A.columns();
+          assert (C.rows() == (trans_A ? A.columns() : A.rows()));
+          assert (C.columns() == (trans_B ? B.rows() : B.columns()));
+          assert (K == (trans_B ? B.columns() : B.rows()));
+          GEMM::gemm (trans_A, trans_B, C.rows(), C.columns(), K,
+              alpha, A.ptr(), A.row_stride(), B.ptr(), B.row_stride(), beta, C.ptr(), C.row_stride());
+        }
+
+      template <typename ValueType>
+        inline void __syrk (CBLAS_UPLO uplo, CBLAS_TRANSPOSE op_A, ValueType alpha, const Matrix<ValueType>& A, ValueType beta, Matrix<ValueType>& C)
+        {
+          const bool trans = op_A != CblasNoTrans;
+          const size_t N = trans ? A.columns() : A.rows();
+          assert (C.rows() == N && C.columns() == N);
+          GEMM::gemm (trans, !trans, N, N, trans ? A.rows() : A.columns(),
+              alpha, A.ptr(), A.row_stride(), A.ptr(), A.row_stride(), beta, C.ptr(), C.row_stride(),
+              uplo == CblasLower ? GEMM::Lower : GEMM::Upper);
+        }
+#endif
+
       // double definitions:
 
       inline void gemm (CBLAS_TRANSPOSE op_A, CBLAS_TRANSPOSE op_B, double alpha, const Matrix<double>& A, const Matrix<double>& B, double beta, Matrix<double>& C)
       {
+#ifdef MRTRIX_BUNDLED_GEMM
+        __gemm (op_A, op_B, alpha, A, B, beta, C);
+#else
         gsl_blas_dgemm (op_A, op_B, alpha, A.gsl(), B.gsl(), beta, C.gsl());
+#endif
       }
 
       inline void gemv (CBLAS_TRANSPOSE op_A, double alpha, const Matrix<double>& A, const Vector<double>& x, double beta, Vector<double>& y)
@@ -764,7 +796,11 @@ namespace MR
 
       inline void syrk (CBLAS_UPLO uplo, CBLAS_TRANSPOSE op_A, double alpha, const Matrix<double>& A, double beta, Matrix<double>& C)
       {
+#ifdef MRTRIX_BUNDLED_GEMM
+        __syrk (uplo, op_A, alpha, A, beta, C);
+#else
         gsl_blas_dsyrk (uplo, op_A, alpha, A.gsl(), beta, C.gsl());
+#endif
       }
 
       // float definitions:
@@ -772,7 +808,11 @@ namespace MR
 
       inline void gemm (CBLAS_TRANSPOSE op_A, CBLAS_TRANSPOSE op_B, float alpha, const Matrix<float>& A, const Matrix<float>& B, float beta, Matrix<float>& C)
       {
+#ifdef MRTRIX_BUNDLED_GEMM
+        __gemm (op_A, op_B, alpha, A, B, beta, C);
+#else
         gsl_blas_sgemm (op_A, op_B, alpha, A.gsl(), B.gsl(), beta, C.gsl());
+#endif
       }
 
       inline void gemv (CBLAS_TRANSPOSE op_A, float alpha, const Matrix<float>& A, const Vector<float>& x, float beta, Vector<float>& y)
@@ -802,7 +842,11 @@ namespace MR
 
       inline void syrk (CBLAS_UPLO uplo, CBLAS_TRANSPOSE op_A, float alpha, const Matrix<float>& A, float beta, Matrix<float>& C)
       {
+#ifdef MRTRIX_BUNDLED_GEMM
+        __syrk (uplo, op_A, alpha, A, beta, C);
+#else
         gsl_blas_ssyrk (uplo, op_A, alpha, A.gsl(), beta, C.gsl());
+#endif
       }
 
 
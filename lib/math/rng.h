@@ -23,9 +23,11 @@
 #ifndef __math_simulation_h__
 #define __math_simulation_h__
 
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
 #include <sys/time.h>
+#include <stdint.h>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
 
 #include "math/vector.h"
 
@@ -34,69 +36,266 @@ namespace MR
   namespace Math
   {
 
+    //! a counter-based random number generator
+    /*! This implements the Philox4x32-10 generator (Salmon et al.,
+     * "Parallel random numbers: as easy as 1, 2, 3", SC'11), in which each
+     * block of 4 outputs is a function of the 64-bit key (the seed) and a
+     * 128-bit counter only. Half of the counter is used to select a
+     * stream, and the other half for the position within that stream, so
+     * that any number of independent streams can be drawn from the same
+     * seed. Using one stream per item of work (e.g. per streamline) makes
+     * the numbers drawn for each item independent of the order in which
+     * items are processed, and hence of the number of threads used.
+     *
+     * If the MRTRIX_RNG_SEED environment variable is set, its value is used
+     * as the seed for all generators not given an explicit seed, so that
+     * results can be reproduced; otherwise the seed is taken from the
+     * current time. Each such generator, and each copy of a generator, is
+     * assigned a different stream, counting down from the last. */
     class RNG
     {
       public:
         RNG () {
-          generator = gsl_rng_alloc (gsl_rng_mt19937);
-          struct timeval tv;
-          gettimeofday (&tv, NULL);
-          set (tv.tv_sec ^ tv.tv_usec);
+          const char* seed = getenv ("MRTRIX_RNG_SEED");
+          if (seed)
+            set (strtoull (seed, NULL, 0));
+          else {
+            struct timeval tv;
+            gettimeofday (&tv, NULL);
+            set (tv.tv_sec ^ tv.tv_usec);
+          }
+          set_stream (new_stream());
         }
         RNG (size_t seed) {
-          generator = gsl_rng_alloc (gsl_rng_mt19937);
           set (seed);
         }
         RNG (const RNG& rng) {
-          generator = gsl_rng_alloc (gsl_rng_mt19937);
-          set (rng.get()+1);
-        }
-        ~RNG ()           {
-          gsl_rng_free (generator);
+          key[0] = rng.key[0];
+          key[1] = rng.key[1];
+          set_stream (new_stream());
         }
 
+        RNG& operator= (const RNG& rng) {
+          key[0] = rng.key[0];
+          key[1] = rng.key[1];
+          set_stream (new_stream());
+          return *this;
+        }
 
 
-        void set (size_t seed) {
-          gsl_rng_set (generator, seed);
+        //! set the seed, and select the first stream
+        void set (uint64_t seed) {
+          key[0] = uint32_t (seed);
+          key[1] = uint32_t (seed >> 32);
+          set_stream (0);
         }
 
-        size_t get () const {
-          return gsl_rng_get (generator);
+        //! select stream \a stream, starting from its first value
+        void set_stream (uint64_t stream) {
+          counter[0] = counter[1] = 0;
+          counter[2] = uint32_t (stream);
+          counter[3] = uint32_t (stream >> 32);
+          next = 4;
+          has_spare = false;
         }
 
-
-        gsl_rng*  operator() ()                    {
-          return generator;
+        //! get the next 32-bit random integer
+        uint32_t get () {
+          if (next == 4) {
+            __block (buffer, counter);
+            __increment();
+            next = 0;
+          }
+          return buffer[next++];
         }
 
-        float uniform ()              {
-          return gsl_rng_uniform (generator);
+
+        //! a uniform random number in the interval [0,1)
+        float uniform () {
+          return __to_float (get());
         }
+        //! a uniform random integer in the range [0,max)
         size_t uniform_int (size_t max) {
-          return gsl_rng_uniform_int (generator, max);
+          if (uint64_t (max) <= (uint64_t (1) << 32)) {
+            // reject values that would bias the result towards low numbers:
+            const uint64_t limit = (uint64_t (1) << 32) - (uint64_t (1) << 32) % max;
+            uint64_t r;
+            do { r = get(); } while (r >= limit);
+            return r % max;
+          }
+          const uint64_t limit = uint64_t (-1) - uint64_t (-1) % max;
+          uint64_t r;
+          do { r = (uint64_t (get()) << 32) | get(); } while (r >= limit);
+          return r % max;
         }
+        //! a normally distributed random number, using the Box-Muller transform
         float normal (float SD = 1.0) {
-          return gsl_ran_gaussian (generator, SD);
+          if (has_spare) {
+            has_spare = false;
+            return SD * spare;
+          }
+          const uint32_t u1 = get(), u2 = get();
+          float z0;
+          __box_muller (z0, spare, u1, u2);
+          has_spare = true;
+          return SD * z0;
         }
         float rician (float amplitude, float SD) {
-          amplitude += gsl_ran_gaussian_ratio_method (generator, SD);
-          float imag = gsl_ran_gaussian_ratio_method (generator, SD);
+          amplitude += normal (SD);
+          float imag = normal (SD);
           return sqrt (amplitude*amplitude + imag*imag);
         }
 
+
+        //! fill \a dest with \a num uniform random numbers in the interval [0,1)
+        /*! This produces the same values as \a num calls to uniform(), but
+         * generates blocks for successive counters together using SIMD
+         * instructions. */
+        void uniform (float* dest, size_t num) {
+          uint32_t raw[__chunk];
+          while (num) {
+            const size_t n = std::min (num, size_t (__chunk));
+            fill (raw, n);
+            for (size_t i = 0; i < n; ++i)
+              dest[i] = __to_float (raw[i]);
+            dest += n;
+            num -= n;
+          }
+        }
+
+        //! fill \a dest with \a num normally distributed random numbers
+        /*! This produces the same values as \a num calls to normal(). */
+        void normal (float* dest, size_t num, float SD = 1.0) {
+          if (num && has_spare) {
+            *dest++ = normal (SD);
+            --num;
+          }
+          uint32_t raw[__chunk];
+          while (num > 1) {
+            const size_t n = std::min (num & ~size_t (1), size_t (__chunk));
+            fill (raw, n);
+            for (size_t i = 0; i < n; i += 2) {
+              __box_muller (dest[i], dest[i+1], raw[i], raw[i+1]);
+              dest[i] *= SD;
+              dest[i+1] *= SD;
+            }
+            dest += n;
+            num -= n;
+          }
+          if (num)
+            *dest = normal (SD);
+        }
+
+        //! fill \a dest with the next \a num 32-bit random integers
+        void fill (uint32_t* dest, size_t num) {
+          for (; num && next < 4; --num)
+            *dest++ = buffer[next++];
+          for (; num >= 4*__lanes; num -= 4*__lanes, dest += 4*__lanes) {
+            __blocks (dest, counter);
+            for (size_t n = 0; n < __lanes; ++n)
+              __increment();
+          }
+          for (; num; --num)
+            *dest++ = get();
+        }
+
+
         template <typename T> void shuffle (Vector<T>& V) {
-          gsl_ran_shuffle (generator, V->ptr(), V.size(), sizeof (T));
+          for (size_t i = V.size(); i > 1; --i)
+            std::swap (V[i-1], V[uniform_int (i)]);
         }
         template <class T> void shuffle (std::vector<T>& V) {
-          gsl_ran_shuffle (generator, &V[0], V.size(), sizeof (T));
+          for (size_t i = V.size(); i > 1; --i)
+            std::swap (V[i-1], V[uniform_int (i)]);
         }
 
 
       protected:
-        gsl_rng* generator;
-    };
+        uint32_t key[2], counter[4], buffer[4];
+        size_t next;
+        float spare;
+        bool has_spare;
 
+        static const size_t __chunk = 256, __lanes = 16;
+        static const uint32_t __M0 = 0xD2511F53, __M1 = 0xCD9E8D57;
+        static const uint32_t __W0 = 0x9E3779B9, __W1 = 0xBB67AE85;
+
+        static uint64_t new_stream () {
+          static uint64_t streams = 0;
+          return ~__sync_fetch_and_add (&streams, 1);
+        }
+
+        void __increment () {
+          if (!++counter[0])
+            ++counter[1];
+        }
+
+        // map the upper 24 bits of x onto [0,1):
+        static float __to_float (uint32_t x) {
+          return (x >> 8) * (1.0f / 16777216.0f);
+        }
+
+        static void __box_muller (float& z0, float& z1, uint32_t u1, uint32_t u2) {
+          const float r = std::sqrt (-2.0f * std::log (__to_float (u1) + 1.0f / 16777216.0f));
+          const float theta = float (2.0 * M_PI) * __to_float (u2);
+          z0 = r * std::cos (theta);
+          z1 = r * std::sin (theta);
+        }
+
+        // the block of 4 outputs for counter ctr:
+        void __block (uint32_t* out, const uint32_t* ctr) const {
+          uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+          uint32_t k0 = key[0], k1 = key[1];
+          for (size_t round = 0; round < 10; ++round) {
+            if (round) {
+              k0 += __W0;
+              k1 += __W1;
+            }
+            const uint64_t p0 = uint64_t (__M0) * c0, p1 = uint64_t (__M1) * c2;
+            c0 = uint32_t (p1 >> 32) ^ c1 ^ k0;
+            c1 = uint32_t (p1);
+            c2 = uint32_t (p0 >> 32) ^ c3 ^ k1;
+            c3 = uint32_t (p0);
+          }
+          out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+        }
+
+        // the blocks of 4 outputs for the next __lanes counters from ctr,
+        // computed together with one block per vector lane. The vectors span
+        // several SIMD registers, which hides the latency of the multiplies:
+        void __blocks (uint32_t* out, const uint32_t* ctr) const {
+          typedef uint64_t vector_type __attribute__ ((vector_size (8*__lanes)));
+          const uint64_t mask = 0xFFFFFFFF;
+          vector_type c0, c1, c2, c3;
+          uint32_t lo = ctr[0], hi = ctr[1];
+          for (size_t n = 0; n < __lanes; ++n) {
+            c0[n] = lo;
+            c1[n] = hi;
+            c2[n] = ctr[2];
+            c3[n] = ctr[3];
+            if (!++lo)
+              ++hi;
+          }
+          uint32_t k0 = key[0], k1 = key[1];
+          for (size_t round = 0; round < 10; ++round) {
+            if (round) {
+              k0 += __W0;
+              k1 += __W1;
+            }
+            const vector_type p0 = (c0 & mask) * (__M0 & mask), p1 = (c2 & mask) * (__M1 & mask);
+            c0 = (p1 >> 32) ^ c1 ^ uint64_t (k0);
+            c1 = p1 & mask;
+            c2 = (p0 >> 32) ^ c3 ^ uint64_t (k1);
+            c3 = p0 & mask;
+          }
+          for (size_t n = 0; n < __lanes; ++n, out += 4) {
+            out[0] = c0[n];
+            out[1] = c1[n];
+            out[2] = c2[n];
+            out[3] = c3[n];
+          }
+        }
+    };
 
     inline float cauchy (float x, float s)
     {
@@ -23,6 +23,7 @@
 
 #include "math/vector.h"
 #include "math/matrix.h"
+#include "math/rng.h"
 
 namespace MR
 {
@@ -71,10 +72,11 @@ namespace MR
           permutations.push_back (default_labelling);
           ++p;
         }
+        Math::RNG rng;
         for (;p < num_perms; ++p) {
           std::vector<size_t> permuted_labelling (default_labelling);
           do {
-            std::random_shuffle (permuted_labelling.begin(), permuted_labelling.end());
+            rng.shuffle (permuted_labelling);
           } while (is_duplicate_permutation (permuted_labelling, permutations));
           permutations.push_back (permuted_labelling);
         }
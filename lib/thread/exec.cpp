@@ -56,10 +56,8 @@ namespace MR
     void (*Exec::Common::previous_report_to_user_func) (const std::string& msg, int type) = NULL;
 
     Exec::Common::Common () :
-      refcount (0), attributes (new pthread_attr_t) {
+      refcount (0) {
         DEBUG ("initialising threads...");
-        pthread_attr_init (attributes);
-        pthread_attr_setdetachstate (attributes, PTHREAD_CREATE_JOINABLE);
 
         previous_print_func = print;
         previous_report_to_user_func = report_to_user_func;
@@ -74,9 +72,6 @@ namespace MR
       report_to_user_func = previous_report_to_user_func;
 
       DEBUG ("uninitialising threads...");
-
-      pthread_attr_destroy (attributes);
-      delete attributes;
     }
 
     void Exec::Common::thread_print_func (const std::string& msg)
@@ -27,6 +27,7 @@
 #include "ptr.h"
 #include "file/config.h"
 #include "thread/mutex.h"
+#include "thread/pool.h"
 
 /** \defgroup Thread Multi-threading
  * \brief functions to provide support for multi-threading
@@ -127,6 +128,11 @@ namespace MR
      * It is also possible to launch an array of threads in parallel. See
      * Thread::Array for details
      *
+     * \note the functor is not run on a newly created thread, but on one of
+     * the persistent worker threads of the process-wide Thread::Pool. This
+     * avoids the overhead of creating and joining threads in commands that
+     * launch many short-lived multi-threaded stages.
+     *
      * The thread is launched by the constructor, and the destructor will wait
      * for the thread to finish.  The lifetime of a thread launched via this
      * method is therefore restricted to the scope of the Exec object. For
@@ -159,35 +165,33 @@ namespace MR
         /*! A human-readable identifier can be supplied via the \a description
          * parameter. This is helping for debugging and error reporting. */
         template <class Functor> Exec (Functor& functor, const std::string& description = "unnamed") :
-          ID (1), name (description) {
+          name (description), completion (1) {
             init();
             DEBUG ("launching thread \"" + name + "\"...");
-            start (ID[0], functor);
+            tasks.push_back (new Task<Functor> (functor, completion));
+            start();
           }
 
         //! Start an array of new threads each runnning the execute() method of its \a functor
         /*! A human-readable identifier can be supplied via the \a description
          * parameter. This is helping for debugging and error reporting. */
         template <class Functor> Exec (Array<Functor>& functor, const std::string& description = "unnamed") :
-          ID (functor.functors.size() +1), name (description) {
+          name (description), completion (functor.functors.size() + 1) {
             init();
-            DEBUG ("launching " + str (ID.size()) + " thread" + (ID.size() > 1 ? "s" : "") +  " \"" + name + "\"...");
-            start (ID[0], functor.first_functor);
-            for (size_t i = 1; i < ID.size(); ++i)
-              start (ID[i], *functor.functors[i-1]);
+            DEBUG ("launching " + str (functor.functors.size() + 1) + " thread" + (functor.functors.size() ? "s" : "") +  " \"" + name + "\"...");
+            tasks.push_back (new Task<Functor> (functor.first_functor, completion));
+            for (size_t i = 0; i < functor.functors.size(); ++i)
+              tasks.push_back (new Task<Functor> (*functor.functors[i], completion));
+            start();
           }
 
         //! Wait for the thread to terminate
         /*! The thread will terminate when the execute() method of the \a
          * functor object returns. */
         ~Exec () {
-          for (size_t i = 0; i < ID.size(); ++i) {
-            DEBUG ("waiting for completion of thread \"" + name + "\" [ID " + str (ID[i]) + "]...");
-            void* status;
-            if (pthread_join (ID[i], &status))
-              throw Exception (std::string ("error joining thread \"" + name + "\" [ID " + str (ID[i]) + "]: ") + strerror (errno));
-            DEBUG ("thread \"" + name + "\" [ID " + str (ID[i]) + "] completed OK");
-          }
+          DEBUG ("waiting for completion of thread" + std::string (tasks.size() > 1 ? "s" : "") + " \"" + name + "\"...");
+          completion.wait();
+          DEBUG ("thread" + std::string (tasks.size() > 1 ? "s" : "") + " \"" + name + "\" completed OK");
 
           --common->refcount;
           if (!common->refcount) {
@@ -197,23 +201,31 @@ namespace MR
         }
 
       private:
-        std::vector<pthread_t> ID;
         const std::string name;
+        Pool::Completion completion;
+        VecPtr<Pool::Task> tasks;
 
-        template <class Functor> void start (pthread_t& id, Functor& functor) {
-          if (pthread_create (&id, common->attributes, static_exec<Functor>, static_cast<void*> (&functor)))
-            throw Exception (std::string ("error launching thread \"" + name + "\": ") + strerror (errno));
-          DEBUG ("launched thread \"" + name + "\" [ID " + str (id) + "]");
-        }
+        template <class Functor> class Task : public Pool::Task
+        {
+          public:
+            Task (Functor& functor, Pool::Completion& completion) :
+              Pool::Task (&completion), func (functor) { }
+
+            void run () {
+              try {
+                func.execute ();
+              }
+              catch (Exception& E) {
+                E.display();
+              }
+            }
+
+          private:
+            Functor& func;
+        };
 
-        template <class Functor> static void* static_exec (void* data) {
-          try {
-            static_cast<Functor*> (data)->execute ();
-          }
-          catch (Exception& E) {
-            E.display();
-          }
-          return (NULL);
+        void start () {
+          Pool::get().submit (std::vector<Pool::Task*> (tasks.begin(), tasks.end()));
         }
 
         void init () {
@@ -228,7 +240,6 @@ namespace MR
             ~Common();
 
             size_t refcount;
-            pthread_attr_t* attributes;
 
             Thread::Mutex mutex;
             static void thread_print_func (const std::string& msg);
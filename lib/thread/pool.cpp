@@ -0,0 +1,142 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstring>
+#include <cerrno>
+
+#include "exception.h"
+#include "thread/pool.h"
+#include "thread/exec.h"
+
+namespace MR
+{
+  namespace Thread
+  {
+
+    namespace {
+
+      Mutex __pool_mutex;
+
+      // deliberately never destroyed: the worker threads may still be
+      // waiting on the pool's condition when the process exits
+      Pool* __pool = NULL;
+
+    }
+
+
+
+    Pool& Pool::get ()
+    {
+      Mutex::Lock lock (__pool_mutex);
+      if (!__pool)
+        __pool = new Pool (std::max (number_of_threads(), size_t (1)));
+      return *__pool;
+    }
+
+
+
+
+    Pool::Pool (size_t initial_size) :
+      more_tasks (mutex),
+      num_workers (0),
+      busy (0)
+    {
+      Mutex::Lock lock (mutex);
+      grow (initial_size);
+    }
+
+
+
+
+    void Pool::submit (const std::vector<Task*>& tasks_to_run)
+    {
+      if (tasks_to_run.empty())
+        return;
+
+      Mutex::Lock lock (mutex);
+
+      // every task must be picked up straight away:
+      const size_t idle = num_workers - busy - tasks.size();
+      if (idle < tasks_to_run.size())
+        grow (tasks_to_run.size() - idle);
+
+      tasks.insert (tasks.end(), tasks_to_run.begin(), tasks_to_run.end());
+      more_tasks.broadcast();
+    }
+
+
+
+
+    void Pool::grow (size_t number_of_workers)
+    {
+      pthread_attr_t attributes;
+      pthread_attr_init (&attributes);
+      pthread_attr_setdetachstate (&attributes, PTHREAD_CREATE_DETACHED);
+
+      for (size_t n = 0; n < number_of_workers; ++n) {
+        pthread_t ID;
+        if (pthread_create (&ID, &attributes, worker_exec, static_cast<void*> (this))) {
+          pthread_attr_destroy (&attributes);
+          throw Exception (std::string ("error launching thread pool worker: ") + strerror (errno));
+        }
+        ++num_workers;
+      }
+
+      pthread_attr_destroy (&attributes);
+      DEBUG ("thread pool now holds " + str (num_workers) + " worker" + (num_workers > 1 ? "s" : ""));
+    }
+
+
+
+
+    void* Pool::worker_exec (void* data)
+    {
+      Pool& pool (*static_cast<Pool*> (data));
+
+      while (true) {
+        Task* task;
+        {
+          Mutex::Lock lock (pool.mutex);
+          while (pool.tasks.empty())
+            pool.more_tasks.wait();
+          task = pool.tasks.front();
+          pool.tasks.pop_front();
+          ++pool.busy;
+        }
+
+        task->run();
+
+        {
+          Mutex::Lock lock (pool.mutex);
+          --pool.busy;
+        }
+
+        if (task->done)
+          task->done->notify();
+      }
+
+      return NULL;
+    }
+
+  }
+}
+
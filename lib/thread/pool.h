@@ -0,0 +1,154 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __mrtrix_thread_pool_h__
+#define __mrtrix_thread_pool_h__
+
+#include <cassert>
+#include <deque>
+#include <vector>
+
+#include "thread/mutex.h"
+#include "thread/condition.h"
+
+namespace MR
+{
+  namespace Thread
+  {
+
+    /** \addtogroup thread_basics
+     * @{ */
+
+    //! A process-wide pool of persistent worker threads
+    /*! All threads launched via Thread::Exec (and hence Thread::Array,
+     * Image::ThreadedLoop and Thread::run_queue()) are run on the worker
+     * threads of this pool, rather than on freshly created threads. The
+     * pool is created on first use with Thread::number_of_threads() workers,
+     * and the workers persist for the lifetime of the process, so that
+     * commands invoking many short multi-threaded stages do not pay the cost
+     * of thread creation at each stage.
+     *
+     * Tasks are held on a single queue, and picked up in order of
+     * submission by the next available worker. Each task typically runs for
+     * the lifetime of a thread in the original sense, so the queue is only
+     * accessed briefly at the start and end of each task.
+     *
+     * Since tasks submitted together are typically expected to run
+     * concurrently (for instance the source, pipe and sink stages of a
+     * Thread::run_queue() pipeline will block waiting on each other), the
+     * pool guarantees that each task will be picked up by a worker
+     * immediately: if there are not enough idle workers when the tasks are
+     * submitted, the pool will grow to accommodate them. These additional
+     * workers then remain available for subsequent submissions.
+     *
+     * \note There should be no need to use this class directly: use
+     * Thread::Exec instead. */
+    class Pool
+    {
+      public:
+        class Completion;
+
+        //! A unit of work to be run by a worker thread
+        /*! If \a completion is supplied, it will be notified once the task
+         * has completed and its worker is available for further tasks. */
+        class Task
+        {
+          public:
+            Task (Completion* completion = NULL) : done (completion) { }
+            virtual ~Task () { }
+            virtual void run () = 0;
+          private:
+            Completion* done;
+            friend class Pool;
+        };
+
+        //! Keeps track of the number of outstanding tasks
+        /*! Used to wait for completion of a set of tasks, as a replacement
+         * for joining threads. */
+        class Completion
+        {
+          public:
+            Completion (size_t number_of_tasks = 0) :
+              finished (mutex),
+              remaining (number_of_tasks) { }
+
+            //! register additional outstanding tasks
+            void add (size_t number_of_tasks = 1) {
+              Mutex::Lock lock (mutex);
+              remaining += number_of_tasks;
+            }
+            //! signal that one of the outstanding tasks has completed
+            void notify () {
+              Mutex::Lock lock (mutex);
+              assert (remaining);
+              if (!--remaining)
+                finished.broadcast();
+            }
+            //! wait until all outstanding tasks have completed
+            void wait () {
+              Mutex::Lock lock (mutex);
+              while (remaining)
+                finished.wait();
+            }
+
+          private:
+            Mutex mutex;
+            Cond finished;
+            size_t remaining;
+        };
+
+        //! get the process-wide pool, creating it if necessary
+        static Pool& get ();
+
+        //! submit tasks for execution
+        /*! All tasks are guaranteed to start running concurrently, without
+         * waiting for any other task to complete. Ownership of the tasks
+         * remains with the caller, who must ensure they remain valid until
+         * they have completed. */
+        void submit (const std::vector<Task*>& tasks);
+
+        //! the number of worker threads currently in the pool
+        size_t size () {
+          Mutex::Lock lock (mutex);
+          return num_workers;
+        }
+
+      private:
+        Mutex mutex;
+        Cond more_tasks;
+        std::deque<Task*> tasks;
+        size_t num_workers, busy;
+
+        Pool (size_t initial_size);
+        Pool (const Pool& pool) : more_tasks (mutex) { assert (0); }
+
+        void grow (size_t number_of_workers);
+
+        static void* worker_exec (void* data);
+    };
+
+    /** @} */
+  }
+}
+
+#endif
+
@@ -24,11 +24,10 @@
 #ifndef __mrtrix_thread_queue_h__
 #define __mrtrix_thread_queue_h__
 
-#include <stack>
-
 #include "ptr.h"
 #include "thread/condition.h"
 #include "thread/exec.h"
+#include "thread/statistics.h"
 
 #define MRTRIX_QUEUE_DEFAULT_CAPACITY 128
 #define MRTRIX_QUEUE_DEFAULT_BATCH_SIZE 128
@@ -66,6 +65,136 @@ namespace MR
 
 
 
+      /********************************************************************
+       * bounded lock-free multi-producer / multi-consumer FIFO of pointers, 
+       * used as the backing store for Thread::Queue. This is the array-based
+       * design due to D. Vyukov: each cell carries a sequence number that
+       * indicates whether it is ready to be written to or read from for the
+       * current lap around the buffer, so that producers and consumers only
+       * ever contend on a single compare-and-swap of their respective index.
+       ********************************************************************/
+
+      template <class T>
+        class __RingBuffer {
+          public:
+            __RingBuffer (size_t min_capacity) : 
+              mask (capacity_for (min_capacity) - 1),
+              cells (new Cell [mask+1]),
+              enqueue_pos (0),
+              dequeue_pos (0) {
+                for (size_t n = 0; n <= mask; ++n) {
+                  cells[n].sequence = n;
+                  cells[n].data = NULL;
+                }
+              }
+
+            ~__RingBuffer () {
+              delete [] cells;
+            }
+
+            //! returns false without blocking if the buffer is full
+            bool push (T* data) {
+              Cell* cell;
+              size_t pos = enqueue_pos;
+              while (true) {
+                cell = cells + (pos & mask);
+                const ssize_t diff = ssize_t (cell->sequence) - ssize_t (pos);
+                if (diff == 0) {
+                  if (__sync_bool_compare_and_swap (&enqueue_pos, pos, pos+1)) 
+                    break;
+                  pos = enqueue_pos;
+                }
+                else if (diff < 0) 
+                  return false;
+                else 
+                  pos = enqueue_pos;
+              }
+              cell->data = data;
+              __sync_synchronize();
+              cell->sequence = pos+1;
+              return true;
+            }
+
+            //! returns false without blocking if the buffer is empty
+            bool pop (T*& data) {
+              Cell* cell;
+              size_t pos = dequeue_pos;
+              while (true) {
+                cell = cells + (pos & mask);
+                const ssize_t diff = ssize_t (cell->sequence) - ssize_t (pos+1);
+                if (diff == 0) {
+                  if (__sync_bool_compare_and_swap (&dequeue_pos, pos, pos+1)) 
+                    break;
+                  pos = dequeue_pos;
+                }
+                else if (diff < 0) 
+                  return false;
+                else 
+                  pos = dequeue_pos;
+              }
+              __sync_synchronize();
+              data = cell->data;
+              __sync_synchronize();
+              cell->sequence = pos + mask + 1;
+              return true;
+            }
+
+            size_t capacity () const { return mask+1; }
+            //! approximate number of items in the buffer
+            size_t size () const { 
+              const size_t n = enqueue_pos - dequeue_pos;
+              return n > capacity() ? 0 : n; 
+            }
+
+          private:
+            class Cell {
+              public:
+                volatile size_t sequence;
+                T* data;
+            };
+
+            const size_t mask;
+            Cell* const cells;
+            // keep producer and consumer indices on separate cache lines:
+            char pad0 [64];
+            volatile size_t enqueue_pos;
+            char pad1 [64];
+            volatile size_t dequeue_pos;
+            char pad2 [64];
+
+            static size_t capacity_for (size_t min_capacity) {
+              size_t n = 2;
+              while (n < min_capacity) n <<= 1;
+              return n;
+            }
+
+            __RingBuffer (const __RingBuffer& R) : mask (0), cells (NULL) { assert (0); }
+        };
+
+
+
+      // to report the memory held by the items in a queue: items that are
+      // (or derive from) a std::vector also hold their capacity on the heap
+      template <class V, class A> char __is_vector (const std::vector<V,A>*);
+      long __is_vector (...);
+
+      template <class V, class A> 
+        size_t __capacity_bytes (const std::vector<V,A>& item) { return item.capacity() * sizeof (V); }
+
+      template <class X, bool IsVector = (sizeof (__is_vector ((X*) NULL)) == sizeof (char))>
+        class __storage
+        {
+          public:
+            static size_t bytes (const X& item) { return sizeof (X); }
+        };
+
+      template <class X>
+        class __storage <X, true>
+        {
+          public:
+            static size_t bytes (const X& item) { return sizeof (X) + __capacity_bytes (item); }
+        };
+
       // to handle batched / unbatched seamlessly:
       template <class X> class __item { public: typedef X type; }; 
       template <class X> class __item < __Batch<X> > { public: typedef X type; };
@@ -154,8 +283,8 @@ namespace MR
      *
      * By default, items are push to and pulled from the queue one by one. In
      * situations where the amount of processing per item is small, items can
-     * be sent in batches to reduce the overhead of thread management (mutex
-     * locking/unlocking, etc). 
+     * be sent in batches to reduce the overhead of thread management
+     * (synchronisation, waking up sleeping threads, etc). 
      *
      * The simplest way to use this functionality is via the
      * Thread::run_queue() and associated Thread::multi() and Thread::batch()
@@ -175,6 +304,12 @@ namespace MR
      * queue, so that they can each be processed in one or more separate
      * threads. 
      *
+     * The queue is implemented as a bounded lock-free ring buffer, allowing
+     * multiple writers and readers to push and pull items concurrently
+     * without contending on a lock. Threads will only block (on a mutex and
+     * condition variable) when the queue is full (for writers) or empty (for
+     * readers).
+     *
      * \note In practice, it is almost always simpler to use the convenience
      * function Thread::run_queue(). You should never need to use the
      * Thread::Queue directly unless you have a very unusual situation.
@@ -390,35 +525,46 @@ namespace MR
         Queue (const std::string& description = "unnamed", size_t buffer_size = MRTRIX_QUEUE_DEFAULT_CAPACITY) :
           more_data (mutex),
           more_space (mutex),
-          buffer (new T* [buffer_size]),
-          front (buffer),
-          back (buffer),
-          capacity (buffer_size),
+          fifo (buffer_size),
+          recycled (2*buffer_size),
           writer_count (0),
           reader_count (0),
+          data_waiters (0),
+          space_waiters (0),
+          stats (QueueStatistics::enabled() ? new QueueStatistics (description, fifo.capacity()) : NULL),
           name (description) {
-          assert (capacity > 0);
+          assert (buffer_size > 0);
         }
 
         //! needed for Thread::run_queue()
         Queue (const T& item_type, const std::string& description = "unnamed", size_t buffer_size = MRTRIX_QUEUE_DEFAULT_CAPACITY) :
           more_data (mutex),
           more_space (mutex),
-          buffer (new T* [buffer_size]),
-          front (buffer),
-          back (buffer),
-          capacity (buffer_size),
+          fifo (buffer_size),
+          recycled (2*buffer_size),
           writer_count (0),
           reader_count (0),
+          data_waiters (0),
+          space_waiters (0),
+          stats (QueueStatistics::enabled() ? new QueueStatistics (description, fifo.capacity()) : NULL),
           name (description) {
-          assert (capacity > 0);
+          assert (buffer_size > 0);
         }
 
 
+        //! Report the number of items allocated, and the memory they hold
+        /*! Since items are recycled, this should remain small compared
+         * with the number of items that passed through the queue. */
         ~Queue () {
-          delete [] buffer;
+          if (items.size()) {
+            size_t bytes = 0;
+            for (size_t n = 0; n < items.size(); ++n)
+              bytes += __storage<T>::bytes (*items[n]);
+            DEBUG ("queue \"" + name + "\": " + str (items.size()) + " items allocated, holding " + str (bytes) + " bytes");
+          }
         }
 
+
         //! This class is used to register a writer with the queue
         /*! Items cannot be written directly onto a Thread::Queue queue. An
          * object of this class must first be instanciated to notify the queue
@@ -566,16 +712,14 @@ namespace MR
       private:
         Mutex mutex;
         Cond more_data, more_space;
-        T** buffer;
-        T** front;
-        T** back;
-        size_t capacity;
-        size_t writer_count, reader_count;
-        std::stack<T*,std::vector<T*> > item_stack;
+        __RingBuffer<T> fifo, recycled;
+        volatile size_t writer_count, reader_count;
+        volatile size_t data_waiters, space_waiters;
         VecPtr<T> items;
+        Ptr<QueueStatistics> stats;
         std::string name;
 
-        Queue (const Queue& queue) {
+        Queue (const Queue& queue) : more_data (mutex), more_space (mutex), fifo (1), recycled (1) {
           assert (0);
         }
         Queue& operator= (const Queue& queue) {
@@ -586,6 +730,7 @@ namespace MR
         void register_writer ()   {
           Mutex::Lock lock (mutex);
           ++writer_count;
+          if (stats) stats->registered (true);
         }
         void unregister_writer () {
           Mutex::Lock lock (mutex);
@@ -599,6 +744,7 @@ namespace MR
         void register_reader ()   {
           Mutex::Lock lock (mutex);
           ++reader_count;
+          if (stats) stats->registered (false);
         }
         void unregister_reader () {
           Mutex::Lock lock (mutex);
@@ -610,58 +756,96 @@ namespace MR
           }
         }
 
-        bool empty () const {
-          return (front == back);
-        }
-        bool full () const {
-          return (inc (back) == front);
-        }
         size_t size () const {
-          return ( (back < front ? back+capacity : back) - front);
+          return fifo.size();
         }
 
+        // items are recycled through a second lock-free buffer; the mutex
+        // is only needed when a new item needs to be allocated:
         T* get_item () {
+          T* item;
+          if (recycled.pop (item))
+            return item;
           Mutex::Lock lock (mutex);
-          T* item = new T;
+          item = new T;
           items.push_back (item);
-          return (item);
+          return item;
         }
 
+        void recycle (T* item) {
+          // if the recycling buffer is full, the item remains owned by
+          // 'items' and will be freed along with the queue:
+          recycled.push (item);
+        }
+
+        // the lock-free FIFO is tried first; the mutex and condition
+        // variables are only used to sleep while the queue is full (for
+        // writers) or empty (for readers). Sleepers register themselves
+        // before retrying, and the other side checks for sleepers after
+        // each successful operation, so that no wake-up can be missed:
         bool push (T*& item) {
-          Mutex::Lock lock (mutex);
-          while (full() && reader_count) more_space.wait();
-          if (!reader_count) return (false);
-          *back = item;
-          back = inc (back);
-          more_data.signal();
-          if (item_stack.empty()) {
-            item = new T;
-            items.push_back (item);
+          if (!reader_count) 
+            return false;
+
+          if (!fifo.push (item)) {
+            Mutex::Lock lock (mutex);
+            const double start = stats ? stats->now() : 0.0;
+            __sync_fetch_and_add (&space_waiters, 1);
+            while (!fifo.push (item)) {
+              if (!reader_count) {
+                __sync_fetch_and_sub (&space_waiters, 1);
+                if (stats) stats->blocked_on_push (stats->now() - start);
+                return false;
+              }
+              more_space.wait();
+            }
+            __sync_fetch_and_sub (&space_waiters, 1);
+            if (stats) stats->blocked_on_push (stats->now() - start);
           }
-          else {
-            item = item_stack.top();
-            item_stack.pop();
+
+          if (stats) 
+            stats->pushed (fifo.size());
+
+          if (__sync_fetch_and_add (&data_waiters, 0)) {
+            Mutex::Lock lock (mutex);
+            more_data.signal();
           }
-          return (true);
+
+          item = get_item();
+          return true;
         }
 
         bool pop (T*& item) {
-          Mutex::Lock lock (mutex);
           if (item) 
-            item_stack.push (item);
+            recycle (item);
           item = NULL;
-          while (empty() && writer_count) more_data.wait();
-          if (empty() && !writer_count) return (false);
-          item = *front;
-          front = inc (front);
-          more_space.signal();
-          return (true);
-        }
 
-        T** inc (T** p) const {
-          ++p;
-          if (p >= buffer + capacity) p = buffer;
-          return (p);
+          if (!fifo.pop (item)) {
+            Mutex::Lock lock (mutex);
+            const double start = stats ? stats->now() : 0.0;
+            __sync_fetch_and_add (&data_waiters, 1);
+            while (!fifo.pop (item)) {
+              if (!writer_count) {
+                __sync_fetch_and_sub (&data_waiters, 1);
+                if (stats) stats->blocked_on_pop (stats->now() - start);
+                item = NULL;
+                return false;
+              }
+              more_data.wait();
+            }
+            __sync_fetch_and_sub (&data_waiters, 1);
+            if (stats) stats->blocked_on_pop (stats->now() - start);
+          }
+
+          if (stats) 
+            stats->popped();
+
+          if (__sync_fetch_and_add (&space_waiters, 0)) {
+            Mutex::Lock lock (mutex);
+            more_space.signal();
+          }
+
+          return true;
         }
     };
 
@@ -0,0 +1,219 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "app.h"
+#include "file/config.h"
+#include "thread/mutex.h"
+#include "thread/statistics.h"
+
+namespace MR
+{
+  namespace Thread
+  {
+
+    namespace {
+
+      int __enabled = -1;
+      Mutex __mutex;
+      std::vector<QueueStatistics>* __records = NULL;
+
+      std::string __stage_name (const std::string& queue_name, bool writer) 
+      {
+        size_t n = queue_name.find ("->");
+        if (n == std::string::npos) 
+          return writer ? "writers" : "readers";
+        return writer ? queue_name.substr (0, n) : queue_name.substr (n+2);
+      }
+
+      std::string __json_string (const std::string& text)
+      {
+        std::string escaped;
+        for (size_t n = 0; n < text.size(); ++n) {
+          const unsigned char c = text[n];
+          if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+          }
+          else if (c < 0x20) {
+            char code[8];
+            snprintf (code, sizeof (code), "\\u%04x", c);
+            escaped += code;
+          }
+          else 
+            escaped += c;
+        }
+        return "\"" + escaped + "\"";
+      }
+
+      std::string __percent (double fraction) 
+      {
+        return str (int (100.0*fraction + 0.5)) + "%";
+      }
+
+      void __report_at_exit () 
+      {
+        QueueStatistics::report();
+      }
+
+    }
+
+
+
+    //CONF option: QueueStatistics
+    //CONF default: 0 (false)
+    //CONF record and report the throughput, stall time and occupancy of
+    //CONF the queues between the stages of multi-threaded pipelines.
+
+    //CONF option: QueueStatisticsFile
+    //CONF default: none
+    //CONF if queue statistics are enabled, also write them in JSON
+    //CONF format to the file specified.
+
+    bool QueueStatistics::enabled ()
+    {
+      if (__enabled < 0) 
+        __enabled = App::get_options ("queuestats").size() || File::Config::get_bool ("QueueStatistics", false);
+      return __enabled;
+    }
+
+
+
+
+    QueueStatistics::QueueStatistics (const std::string& name, size_t capacity) :
+      name (name),
+      capacity (capacity),
+      start (now()),
+      elapsed (0.0),
+      stored (false),
+      num_writers (0),
+      num_readers (0),
+      num_pushed (0),
+      num_popped (0),
+      push_stalls (0),
+      pop_stalls (0),
+      push_wait (0.0),
+      pop_wait (0.0)
+    {
+      for (size_t n = 0; n < MRTRIX_QUEUE_STATISTICS_BINS; ++n)
+        histogram[n] = 0;
+    }
+
+
+
+    QueueStatistics::~QueueStatistics () 
+    {
+      if (!stored) {
+        elapsed = now() - start;
+        stored = true;
+        Mutex::Lock lock (__mutex);
+        if (!__records) {
+          __records = new std::vector<QueueStatistics>;
+          atexit (__report_at_exit);
+        }
+        __records->push_back (*this);
+      }
+    }
+
+
+
+
+    void QueueStatistics::report () 
+    {
+      Mutex::Lock lock (__mutex);
+      if (!__records) 
+        return;
+
+      CONSOLE ("queue statistics:");
+      for (size_t q = 0; q < __records->size(); ++q) {
+        const QueueStatistics& S ((*__records)[q]);
+        CONSOLE ("  [" + str (q+1) + "] queue \"" + S.name + "\" (capacity " + str (S.capacity) + "), open for " + str (S.elapsed) + " s:");
+        
+        const double writer_time = S.elapsed * std::max (S.num_writers, size_t (1));
+        CONSOLE ("      " + __stage_name (S.name, true) + " (" + str (S.num_writers) + " thread" + (S.num_writers > 1 ? "s" : "") + "): " 
+            + str (S.num_pushed) + " items pushed (" + str (S.elapsed ? S.num_pushed / S.elapsed : 0.0) + " items/s), "
+            + "blocked on full queue " + str (S.push_stalls) + " times for " + str (S.push_wait) + " s (" 
+            + __percent (writer_time ? S.push_wait / writer_time : 0.0) + " of thread time)");
+
+        const double reader_time = S.elapsed * std::max (S.num_readers, size_t (1));
+        CONSOLE ("      " + __stage_name (S.name, false) + " (" + str (S.num_readers) + " thread" + (S.num_readers > 1 ? "s" : "") + "): " 
+            + str (S.num_popped) + " items pulled, "
+            + "blocked on empty queue " + str (S.pop_stalls) + " times for " + str (S.pop_wait) + " s (" 
+            + __percent (reader_time ? S.pop_wait / reader_time : 0.0) + " of thread time)");
+
+        std::string depth;
+        for (size_t n = 0; n < MRTRIX_QUEUE_STATISTICS_BINS; ++n) {
+          if (!S.histogram[n])
+            continue;
+          if (depth.size()) 
+            depth += ", ";
+          depth += str (bin_lower (n));
+          if (bin_upper (n) > bin_lower (n))
+            depth += "-" + str (bin_upper (n));
+          depth += ": " + __percent (S.num_pushed ? double (S.histogram[n]) / S.num_pushed : 0.0);
+        }
+        CONSOLE ("      queue depth on push: " + (depth.size() ? depth : std::string ("n/a")));
+      }
+
+      const std::string filename = File::Config::get ("QueueStatisticsFile");
+      if (filename.size()) {
+        std::ofstream out (filename.c_str());
+        if (!out) {
+          WARN ("error opening queue statistics file \"" + filename + "\": " + strerror (errno));
+        }
+        else {
+          out << "{\n  \"queues\": [";
+          for (size_t q = 0; q < __records->size(); ++q) {
+            const QueueStatistics& S ((*__records)[q]);
+            out << (q ? "," : "") << "\n    {\n"
+              << "      \"name\": " << __json_string (S.name) << ",\n"
+              << "      \"capacity\": " << S.capacity << ",\n"
+              << "      \"elapsed\": " << S.elapsed << ",\n"
+              << "      \"writers\": { \"stage\": " << __json_string (__stage_name (S.name, true)) << ", \"threads\": " << S.num_writers 
+              << ", \"items\": " << S.num_pushed << ", \"stalls\": " << S.push_stalls << ", \"blocked\": " << S.push_wait << " },\n"
+              << "      \"readers\": { \"stage\": " << __json_string (__stage_name (S.name, false)) << ", \"threads\": " << S.num_readers 
+              << ", \"items\": " << S.num_popped << ", \"stalls\": " << S.pop_stalls << ", \"blocked\": " << S.pop_wait << " },\n"
+              << "      \"depth_histogram\": [";
+            bool first = true;
+            for (size_t n = 0; n < MRTRIX_QUEUE_STATISTICS_BINS; ++n) {
+              if (!S.histogram[n])
+                continue;
+              out << (first ? "" : ", ") << "{ \"min\": " << bin_lower (n) << ", \"max\": " << bin_upper (n) << ", \"count\": " << S.histogram[n] << " }";
+              first = false;
+            }
+            out << "]\n    }";
+          }
+          out << "\n  ]\n}\n";
+        }
+      }
+
+      delete __records;
+      __records = NULL;
+    }
+
+  }
+}
+
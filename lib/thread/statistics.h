@@ -0,0 +1,136 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __mrtrix_thread_statistics_h__
+#define __mrtrix_thread_statistics_h__
+
+#include <string>
+#include <vector>
+
+#include "timer.h"
+
+#define MRTRIX_QUEUE_STATISTICS_BINS 32
+
+namespace MR
+{
+  namespace Thread
+  {
+
+    /** \addtogroup thread_queue
+     * @{ */
+
+    //! Records activity on a Thread::Queue for performance analysis
+    /*! When enabled (using the -queuestats command-line option, or by setting
+     * the QueueStatistics configuration entry to true), each Thread::Queue
+     * records the number of items that pass through it, the time its writer
+     * and reader stages spend blocked waiting for space or data, and a
+     * histogram of the queue depth sampled on each push.
+     *
+     * Since the writers of a queue are the upstream stage of a
+     * Thread::run_queue() pipeline, and its readers the downstream stage,
+     * this information is sufficient to identify which stage of the pipeline
+     * is limiting throughput: a stage that spends most of its time blocked
+     * writing to a full queue is waiting on the next stage, while a stage
+     * that spends most of its time blocked reading from an empty queue is
+     * waiting on the previous stage.
+     *
+     * The statistics for all queues are reported when the command exits. If
+     * the QueueStatisticsFile configuration entry is set, they will also be
+     * written in JSON format to the file specified.
+     *
+     * \note There should be no need to use this class directly: it is
+     * managed by Thread::Queue. */
+    class QueueStatistics
+    {
+      public:
+        QueueStatistics (const std::string& name, size_t capacity);
+        //! store the statistics for reporting at exit
+        ~QueueStatistics ();
+
+        //! whether statistics collection was requested
+        static bool enabled ();
+
+        //! register a thread writing to (\a writer = true) or reading from the queue
+        /*! this should be invoked with the queue's mutex held. */
+        void registered (bool writer) {
+          if (writer) ++num_writers;
+          else ++num_readers;
+        }
+
+        //! an item was pushed onto a queue holding \a depth items
+        void pushed (size_t depth) {
+          __sync_fetch_and_add (&num_pushed, 1);
+          __sync_fetch_and_add (&histogram[bin (depth)], 1);
+        }
+        //! an item was pulled off the queue
+        void popped () {
+          __sync_fetch_and_add (&num_popped, 1);
+        }
+
+        //! a writer was blocked for \a seconds waiting for space
+        /*! this should be invoked with the queue's mutex held. */
+        void blocked_on_push (double seconds) {
+          ++push_stalls;
+          push_wait += seconds;
+        }
+        //! a reader was blocked for \a seconds waiting for data
+        /*! this should be invoked with the queue's mutex held. */
+        void blocked_on_pop (double seconds) {
+          ++pop_stalls;
+          pop_wait += seconds;
+        }
+
+        //! print (and optionally write to file) all statistics recorded so far
+        /*! This is invoked automatically when the command exits. */
+        static void report ();
+
+        static double now () { return Timer::current_time(); }
+
+        //! the range of queue depths covered by histogram bin \a n
+        static size_t bin_lower (size_t n) { return n ? size_t (1) << (n-1) : 0; }
+        static size_t bin_upper (size_t n) { return n ? (size_t (1) << n) - 1 : 0; }
+
+      protected:
+        std::string name;
+        size_t capacity;
+        double start, elapsed;
+        bool stored;
+        size_t num_writers, num_readers;
+        volatile size_t num_pushed, num_popped;
+        size_t push_stalls, pop_stalls;
+        double push_wait, pop_wait;
+        volatile size_t histogram [MRTRIX_QUEUE_STATISTICS_BINS];
+
+        // log2 bins: 0, 1, 2-3, 4-7, 8-15, ...
+        static size_t bin (size_t depth) {
+          size_t n = 0;
+          while (depth && n < MRTRIX_QUEUE_STATISTICS_BINS-1) { depth >>= 1; ++n; }
+          return n;
+        }
+    };
+
+    /** @} */
+  }
+}
+
+#endif
+
@@ -111,6 +111,14 @@ namespace MR
     This class provides a RAM-based scratch buffer, with no associated file on
     disk.
 
+    For performance-critical single-pass loops, the Image::direct_access()
+    function can be used to invoke a templated functor with a voxel accessor
+    based on Image::BufferDirect, a variant of Image::Buffer specialised at
+    compile-time for the data type found on file. This avoids the per-voxel
+    cost of the data type conversion functions where the data are stored in
+    native byte order without intensity scaling, and falls back to the
+    standard Image::Buffer otherwise.
+
     In the MRtrix code and documentation, objects that provide an equivalent
     interface to the Image::Buffer classes are often to referred as BufferType
     objects. This terminology is used particularly in naming template
@@ -219,6 +219,12 @@ namespace MR
     launched by constructing a Thread::Array of this class and passing this to
     Thread::Exec. 
 
+    Note that Thread::Exec does not create a new thread each time: the functors
+    are handed over to the persistent worker threads of a process-wide
+    Thread::Pool, which is created on first use with as many workers as
+    specified by Thread::number_of_threads(), and grows as required to ensure
+    all functors launched together can run concurrently.
+
     \note If the class is to be used in multiple concurrent threads (i.e.
     launched using Thread::Array), the class must be copy-constructable,
     and any copy created in this way must be fully independent: if pointers to
@@ -300,7 +300,7 @@ namespace MR {
       {
 
         const float azimuth   = atan2(p[1], p[0]);
-        const float elevation = acos (p[2]);
+        const float elevation = acos (std::max (-1.0f, std::min (p[2], 1.0f)));
 
         const size_t azimuth_grid   = Math::floor (( azimuth  - az_begin) / az_grid_step);
         const size_t elevation_grid = Math::floor ((elevation - el_begin) / el_grid_step);
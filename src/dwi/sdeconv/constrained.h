@@ -204,7 +204,8 @@ namespace MR
           HR_amps (shared.HR_trans.rows()),
           Mt_b (shared.HR_trans.columns()),
           old_neg (shared.HR_trans.rows()),
-          computed_once (false) {
+          computed_once (false),
+          warm_start (false) {
             norm_lambda = NORM_LAMBDA_MULTIPLIER * shared.norm_lambda * shared.Mt_M (0,0);
           }
 
@@ -217,7 +218,8 @@ namespace MR
           HR_amps (shared.HR_trans.rows()),
           Mt_b (shared.HR_trans.columns()),
           old_neg (shared.HR_trans.rows()),
-          computed_once (false) {
+          computed_once (false),
+          warm_start (false) {
             norm_lambda = NORM_LAMBDA_MULTIPLIER * shared.norm_lambda * shared.Mt_M (0,0);
           }
 
@@ -231,18 +233,48 @@ namespace MR
           computed_once = false;
 
           mult (Mt_b, value_type (0.0), value_type (1.0), CblasTrans, shared.M, DW_signals);
+          warm_start = false;
+        }
+
+        //! prepare to deconvolve a block of voxels, one per row of \a DW_signals
+        /*! The products with the DW signals needed to initialise each voxel
+         * are computed for the whole block at once; use set_voxel() to
+         * select each voxel in turn. */
+        void set_block (const Math::Matrix<value_type>& DW_signals) {
+          Math::mult (block_init_F, value_type (1.0), CblasNoTrans, DW_signals, CblasTrans, shared.rconv);
+          Math::mult (block_Mt_b, value_type (1.0), CblasNoTrans, DW_signals, CblasNoTrans, shared.M);
+        }
+
+        //! select voxel \a index of the block passed to set_block()
+        /*! If \a warm is true, the first iteration starts from the set of
+         * negative constraints found for the last voxel processed (typically
+         * a neighbour), rather than from the initial low-order estimate of the
+         * FOD. This usually reduces the number of iterations required; if
+         * the solver does not converge, the voxel should be processed again
+         * with \a warm set to false. */
+        void set_voxel (size_t index, bool warm) {
+          init_F = block_init_F.row (index);
+          F.sub (0, init_F.size()) = init_F;
+          F.sub (init_F.size(), F.size()) = 0.0;
+          Mt_b = block_Mt_b.row (index);
+          old_neg.assign (shared.HR_trans.rows(), -1);
+          computed_once = false;
+          warm_start = warm;
         }
 
         bool iterate() {
-          neg.clear();
-          Math::mult (HR_amps, shared.HR_trans, F);
-          for (size_t n = 0; n < HR_amps.size(); n++)
-            if (HR_amps[n] < shared.threshold)
-              neg.push_back (n);
+          if (warm_start) 
+            warm_start = false;
+          else {
+            neg.clear();
+            Math::mult (HR_amps, shared.HR_trans, F);
+            for (size_t n = 0; n < HR_amps.size(); n++)
+              if (HR_amps[n] < shared.threshold)
+                neg.push_back (n);
+          }
 
           if (computed_once && old_neg == neg)
-            if (old_neg == neg)
-              return true;
+            return true;
 
           for (size_t i = 0; i < work.rows(); i++) 
             for (size_t j = 0; j <= i; j++)
@@ -291,10 +323,10 @@ namespace MR
 
       protected:
         value_type norm_lambda;
-        Math::Matrix<value_type> work, HR_T;
+        Math::Matrix<value_type> work, HR_T, block_init_F, block_Mt_b;
         Math::Vector<value_type> F, init_F, HR_amps, Mt_b;
         std::vector<int> neg, old_neg;
-        bool computed_once;
+        bool computed_once, warm_start;
     };
 
 
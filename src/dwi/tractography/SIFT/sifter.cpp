@@ -60,7 +60,8 @@ namespace MR
         }
         double contributing_length_removed = 0.0, noncontributing_length_removed = 0.0;
         // Randomise the order or removal here; faster than trying to select at random later
-        std::random_shuffle (noncontributing_indices.begin(), noncontributing_indices.end());
+        Math::RNG rng;
+        rng.shuffle (noncontributing_indices);
 
         std::vector<Cost_fn_gradient_sort> gradient_vector;
         gradient_vector.assign (num_tracks(), Cost_fn_gradient_sort (num_tracks(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max()));
@@ -362,10 +363,10 @@ namespace MR
         std::vector<Cost_fn_gradient_sort> gradient_vector;
         gradient_vector.assign (num_tracks, Cost_fn_gradient_sort (num_tracks, 0.0, 0.0));
         // Fill the gradient vector with random Gaussian data
-        for (track_t index = 0; index != num_tracks; ++index) {
-          const float value = rng.normal();
-          gradient_vector[index].set (index, value, value);
-        }
+        std::vector<float> values (num_tracks);
+        rng.normal (&values[0], num_tracks);
+        for (track_t index = 0; index != num_tracks; ++index)
+          gradient_vector[index].set (index, values[index], values[index]);
 
         std::vector<size_t> block_sizes;
         for (size_t i = 16; i < num_tracks; i *= 2)
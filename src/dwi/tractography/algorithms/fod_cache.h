@@ -0,0 +1,287 @@
+/*
+   Copyright 2026 Brain Research Institute, Melbourne, Australia
+
+   Written by agent, 17/10/26.
+
+   This file is part of MRtrix.
+
+   MRtrix is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   MRtrix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with MRtrix.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __dwi_tractography_algorithms_fod_cache_h__
+#define __dwi_tractography_algorithms_fod_cache_h__
+
+#include <vector>
+
+#include "point.h"
+#include "math/SH.h"
+#include "dwi/directions/set.h"
+#include "dwi/tractography/tracking/types.h"
+
+
+namespace MR {
+  namespace DWI {
+    namespace Tractography {
+      namespace Algorithms {
+
+      using namespace MR::DWI::Tractography::Tracking;
+
+
+      // A cache of FOD amplitudes, shared between all tracking threads:
+      //   for each voxel, the FOD amplitudes are evaluated along every direction of a dense
+      //   set of directions over the hemisphere the first time that voxel is needed. Lookups
+      //   then interpolate trilinearly between the amplitudes of the 8 neighbouring voxels
+      //   (which is exact, since the SH transform is linear), and between the 3 closest
+      //   directions of the set (which is not). The accuracy is therefore set by the number
+      //   of directions, and the memory used by that number times the number of voxels
+      //   visited; once the memory limit is reached, no further voxels are added, and
+      //   lookups requiring them must evaluate the FOD directly instead.
+      class FODCache {
+
+        public:
+          FODCache (const SourceBufferType& source, const Math::SH::PrecomputedAL<value_type>& precomputer, const size_t lmax, const size_t num_dirs, const size_t max_MB) :
+            dirs (num_dirs),
+            precomputer (precomputer),
+            lmax (lmax),
+            nx (source.dim(0)),
+            ny (source.dim(1)),
+            tables (source.dim(0) * source.dim(1) * source.dim(2), NULL),
+            max_bytes (max_MB << 20),
+            bytes (0),
+            full (false)
+          {
+            // The lattice spacing: the largest angle between adjacent directions
+            cos_spacing = 1.0;
+            for (size_t i = 0; i != dirs.size(); ++i) {
+              const std::vector<DWI::Directions::dir_t>& adj (dirs.get_adj_dirs (i));
+              for (std::vector<DWI::Directions::dir_t>::const_iterator j = adj.begin(); j != adj.end(); ++j)
+                cos_spacing = std::min (cos_spacing, Math::abs (dirs[i].dot (dirs[*j])));
+            }
+
+            // Cells of the direction lookup grid span at most a quarter of the lattice spacing;
+            //   each holds the (up to) 3 closest directions to its centre, with their interpolation
+            //   weights, so that lookups need no trigonometry or search
+            res = Math::ceil<size_t> (8.0 / Math::acos (cos_spacing));
+            cells.resize (3 * res * res);
+            for (size_t face = 0; face != 3; ++face) {
+              for (size_t iu = 0; iu != res; ++iu) {
+                for (size_t iv = 0; iv != res; ++iv) {
+                  Point<float> p;
+                  p[face] = 1.0;
+                  p[(face+1)%3] = 2.0 * (iu + 0.5) / res - 1.0;
+                  p[(face+2)%3] = 2.0 * (iv + 0.5) / res - 1.0;
+                  p.normalise();
+                  set_cell (cells[(face*res + iu)*res + iv], p);
+                }
+              }
+            }
+
+            INFO ("FOD amplitude cache using " + str (dirs.size()) + " directions (spacing " + str (Math::acos (cos_spacing) * 180.0 / M_PI)
+                + " deg), up to " + str (max_MB) + " MB");
+          }
+
+          ~FODCache ()
+          {
+            size_t count = 0;
+            for (std::vector<float*>::iterator i = tables.begin(); i != tables.end(); ++i) {
+              if (*i) {
+                ++count;
+                delete[] *i;
+              }
+            }
+            INFO ("FOD amplitude cache held " + str (count) + " voxels (" + str (bytes >> 20) + " MB)");
+          }
+
+
+          // Per-thread access to the cache
+          class Interp : public Image::Interp::Linear<SourceBufferType::voxel_type> {
+
+            public:
+              Interp (const FODCache& cache, const SourceBufferType::voxel_type& voxel) :
+                Image::Interp::Linear<SourceBufferType::voxel_type> (voxel),
+                C (cache),
+                coefs (voxel.dim(3)),
+                num_tables (0) { }
+
+              // Set the (scanner-space) position at which to look up amplitudes: returns false if
+              //   the amplitudes for any of the voxels involved couldn't be cached, in which case
+              //   the FOD must be evaluated directly
+              bool set (const Point<value_type>& pos)
+              {
+                num_tables = 0;
+                if (scanner (pos))
+                  return true;
+                const float f[8] = { faaa, faab, faba, fabb, fbaa, fbab, fbba, fbbb };
+                const ssize_t x = (*this)[0], y = (*this)[1], z = (*this)[2];
+                const size_t index = x + C.nx * (y + C.ny * z);
+                for (size_t i = 0; i != 8; ++i) {
+                  if (f[i]) {
+                    const size_t dx = i>>2, dy = (i>>1)&1, dz = i&1;
+                    const float* table = C.tables[index + dx + C.nx * (dy + C.ny * dz)];
+                    if (!table && !(table = fill_table (x + dx, y + dy, z + dz))) {
+                      num_tables = 0;
+                      return false;
+                    }
+                    weights[num_tables] = f[i];
+                    tables[num_tables++] = table;
+                  }
+                }
+                return true;
+              }
+
+              // The FOD amplitude along direction d at the current position (NaN if outside the image)
+              value_type amplitude (const Point<value_type>& d) const
+              {
+                if (!num_tables || !d.valid())
+                  return NAN;
+                const Cell& cell (C.cells[C.cell_index (d)]);
+                return cell.weights[0] * blend (cell.dirs[0]) + cell.weights[1] * blend (cell.dirs[1]) + cell.weights[2] * blend (cell.dirs[2]);
+              }
+
+            private:
+              const FODCache& C;
+              std::vector<value_type> coefs;
+              const float* tables[8];
+              value_type weights[8];
+              size_t num_tables;
+
+              value_type blend (const DWI::Directions::dir_t n) const
+              {
+                value_type value = 0.0;
+                for (size_t i = 0; i != num_tables; ++i)
+                  value += weights[i] * tables[i][n];
+                return value;
+              }
+
+              // Evaluate the amplitudes for a voxel not yet in the cache
+              const float* fill_table (const ssize_t x, const ssize_t y, const ssize_t z)
+              {
+                if (C.full)
+                  return NULL;
+                const size_t index = x + C.nx * (y + C.ny * z);
+                (*this)[0] = x; (*this)[1] = y; (*this)[2] = z;
+                for ((*this)[3] = 0; (*this)[3] < dim(3); ++(*this)[3])
+                  coefs[(*this)[3]] = SourceBufferType::voxel_type::value();
+                (*this)[3] = 0;
+                float* new_table = new float [C.dirs.size()];
+                if (C.precomputer)
+                  C.precomputer.value (new_table, coefs, &C.dirs.get_dirs()[0], C.dirs.size());
+                else
+                  for (size_t n = 0; n != C.dirs.size(); ++n)
+                    new_table[n] = Math::SH::value (coefs, C.dirs[n], C.lmax);
+                const float* table = C.insert (index, new_table);
+                if (table != new_table)
+                  delete[] new_table;
+                return table;
+              }
+          };
+
+
+        private:
+          DWI::Directions::FastLookupSet dirs;
+          const Math::SH::PrecomputedAL<value_type>& precomputer;
+          const size_t lmax;
+          const size_t nx, ny;
+          value_type cos_spacing;
+
+          class Cell {
+            public:
+              DWI::Directions::dir_t dirs[3];
+              float weights[3];
+          };
+
+          size_t res;
+          std::vector<Cell> cells;
+
+          mutable std::vector<float*> tables;
+          const size_t max_bytes;
+          mutable size_t bytes;
+          mutable bool full;
+
+          // Tent weights about each direction, truncated to the 3 largest
+          void set_cell (Cell& cell, const Point<float>& p) const
+          {
+            const DWI::Directions::dir_t nearest = dirs.select_direction (p);
+            const std::vector<DWI::Directions::dir_t>& adj (dirs.get_adj_dirs (nearest));
+            for (size_t i = 0; i != 3; ++i) {
+              cell.dirs[i] = nearest;
+              cell.weights[i] = 0.0;
+            }
+            cell.weights[0] = std::max (Math::abs (p.dot (dirs[nearest])) - cos_spacing, value_type (1.0e-6));
+            for (size_t i = 0; i != adj.size(); ++i) {
+              const float w = Math::abs (p.dot (dirs[adj[i]])) - cos_spacing;
+              if (w > cell.weights[2]) {
+                size_t n = 2;
+                for (; n && w > cell.weights[n-1]; --n) {
+                  cell.dirs[n] = cell.dirs[n-1];
+                  cell.weights[n] = cell.weights[n-1];
+                }
+                cell.dirs[n] = adj[i];
+                cell.weights[n] = w;
+              }
+            }
+            const float sum = cell.weights[0] + cell.weights[1] + cell.weights[2];
+            for (size_t i = 0; i != 3; ++i)
+              cell.weights[i] /= sum;
+          }
+
+          // The cell of the lookup grid containing direction d: d is projected onto the faces of
+          //   a cube, opposite faces sharing the same grid since the amplitudes are antipodally
+          //   symmetric. This avoids the trigonometry involved in FastLookupSet::select_direction(),
+          //   which costs as much as the SH evaluation the cache is meant to replace.
+          size_t cell_index (const Point<value_type>& d) const
+          {
+            const value_type ax = Math::abs (d[0]), ay = Math::abs (d[1]), az = Math::abs (d[2]);
+            size_t face;
+            value_type m, u, v;
+            if (ax >= ay && ax >= az) { face = 0; m = d[0]; u = d[1]; v = d[2]; }
+            else if (ay >= az)        { face = 1; m = d[1]; u = d[2]; v = d[0]; }
+            else                      { face = 2; m = d[2]; u = d[0]; v = d[1]; }
+            const value_type scale = 0.5 * res / m;
+            const value_type fu = (u * scale) + 0.5 * res, fv = (v * scale) + 0.5 * res;
+            const size_t iu = fu > 0.0 ? std::min (size_t (fu), res - 1) : 0;
+            const size_t iv = fv > 0.0 ? std::min (size_t (fv), res - 1) : 0;
+            return (face*res + iu)*res + iv;
+          }
+
+          // Returns the table held for this voxel: either the one provided, or that added
+          //   concurrently by another thread, or NULL if the memory limit has been reached
+          float* insert (const size_t index, float* table) const
+          {
+            const size_t table_bytes = dirs.size() * sizeof (float);
+            if (__sync_add_and_fetch (&bytes, table_bytes) > max_bytes) {
+              __sync_sub_and_fetch (&bytes, table_bytes);
+              if (!full) {
+                full = true;
+                INFO ("FOD amplitude cache full; remaining voxels will be evaluated directly");
+              }
+              return tables[index];
+            }
+            if (__sync_bool_compare_and_swap (&tables[index], (float*) NULL, table))
+              return table;
+            __sync_sub_and_fetch (&bytes, table_bytes);
+            return tables[index];
+          }
+
+      };
+
+
+      }
+    }
+  }
+}
+
+#endif
+
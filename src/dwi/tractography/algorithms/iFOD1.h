@@ -29,6 +29,7 @@
 #include "dwi/tractography/tracking/shared.h"
 #include "dwi/tractography/tracking/types.h"
 #include "dwi/tractography/algorithms/calibrator.h"
+#include "dwi/tractography/algorithms/fod_cache.h"
 
 
 
@@ -78,6 +79,9 @@ namespace MR
           if (precomputed)
             precomputer.init (lmax);
 
+          if (properties.find ("fod_cache_dirs") != properties.end())
+            fod_cache = new FODCache (source_buffer, precomputer, lmax, to<size_t> (properties["fod_cache_dirs"]), to<size_t> (properties["fod_cache_mb"]));
+
         }
 
         ~Shared ()
@@ -105,6 +109,7 @@ namespace MR
         size_t lmax, max_trials;
         value_type sin_max_angle;
         Math::SH::PrecomputedAL<value_type> precomputer;
+        Ptr<FODCache> fod_cache;
 
         private:
         mutable double mean_samples, mean_truncations, max_max_truncation;
@@ -123,7 +128,10 @@ namespace MR
         mean_sample_num (0),
         num_sample_runs (0),
         num_truncations (0),
-        max_truncation (0.0) {
+        max_truncation (0.0),
+        use_cache (false) {
+        if (S.fod_cache)
+          cached = new FODCache::Interp (*S.fod_cache, S.source_voxel);
         calibrate (*this);
       }
 
@@ -176,13 +184,25 @@ namespace MR
 
       term_t next ()
       {
-        if (!get_data (source))
+        use_cache = cached && cached->set (pos);
+        if (!use_cache && !get_data (source))
           return EXIT_IMAGE;
 
+        calibrate_dirs.resize (calibrate_list.size());
+        for (size_t i = 0; i < calibrate_list.size(); ++i)
+          calibrate_dirs[i] = rotate_direction (dir, calibrate_list[i]);
+        calibrate_amps.resize (calibrate_list.size());
+        if (use_cache) {
+          for (size_t i = 0; i < calibrate_dirs.size(); ++i)
+            calibrate_amps[i] = cached->amplitude (calibrate_dirs[i]);
+        }
+        else
+          FOD (&calibrate_amps[0], &calibrate_dirs[0], calibrate_dirs.size());
+
         value_type max_val = 0.0;
         size_t nan_count = 0;
         for (size_t i = 0; i < calibrate_list.size(); ++i) {
-          value_type val = FOD (rotate_direction (dir, calibrate_list[i]));
+          value_type val = calibrate_amps[i];
           if (isnan (val))
             ++nan_count;
           else if (val > max_val)
@@ -201,7 +221,7 @@ namespace MR
 
         for (size_t n = 0; n < S.max_trials; n++) {
           Point<value_type> new_dir = rand_dir (dir);
-          value_type val = FOD (new_dir);
+          value_type val = use_cache ? cached->amplitude (new_dir) : FOD (new_dir);
 
           if (val > S.threshold) {
 
@@ -229,17 +249,20 @@ namespace MR
 
       float get_metric()
       {
-        return FOD (dir);
+        return use_cache ? cached->amplitude (dir) : FOD (dir);
       }
 
 
       protected:
       const Shared& S;
       Interpolator<SourceBufferType::voxel_type>::type source;
+      Ptr<FODCache::Interp> cached;
       value_type calibrate_ratio;
       size_t mean_sample_num, num_sample_runs, num_truncations;
       float max_truncation;
-      std::vector< Point<value_type> > calibrate_list;
+      bool use_cache;
+      std::vector< Point<value_type> > calibrate_list, calibrate_dirs;
+      std::vector<value_type> calibrate_amps;
 
       value_type FOD (const Point<value_type>& d) const
       {
@@ -249,6 +272,16 @@ namespace MR
         );
       }
 
+      // evaluate the FOD along many directions at once:
+      void FOD (value_type* amplitudes, const Point<value_type>* d, size_t num) const
+      {
+        if (S.precomputer)
+          S.precomputer.value (amplitudes, values, d, num);
+        else
+          for (size_t n = 0; n < num; ++n)
+            amplitudes[n] = Math::SH::value (values, d[n], S.lmax);
+      }
+
       Point<value_type> rand_dir (const Point<value_type>& d) { return (random_direction (d, S.max_angle, S.sin_max_angle)); }
 
 
@@ -31,6 +31,7 @@
 #include "dwi/tractography/tracking/shared.h"
 #include "dwi/tractography/tracking/types.h"
 #include "dwi/tractography/algorithms/calibrator.h"
+#include "dwi/tractography/algorithms/fod_cache.h"
 
 
 
@@ -82,6 +83,9 @@ namespace MR
                 if (precomputed)
                   precomputer.init (lmax);
 
+                if (properties.find ("fod_cache_dirs") != properties.end())
+                  fod_cache = new FODCache (source_buffer, precomputer, lmax, to<size_t> (properties["fod_cache_dirs"]), to<size_t> (properties["fod_cache_mb"]));
+
                 // num_samples is number of samples excluding first point
                 --num_samples;
 
@@ -130,6 +134,7 @@ namespace MR
                 size_t lmax, num_samples, max_trials;
                 value_type sin_max_angle, fod_power;
                 Math::SH::PrecomputedAL<value_type> precomputer;
+                Ptr<FODCache> fod_cache;
 
               private:
                 mutable double mean_samples, mean_truncations, max_max_truncation;
@@ -158,6 +163,8 @@ namespace MR
               calib_tangents (S.num_samples),
               sample_idx (S.num_samples)
           {
+            if (S.fod_cache)
+              cached = new FODCache::Interp (*S.fod_cache, S.source_voxel);
             calibrate (*this);
           }
 
@@ -177,6 +184,8 @@ namespace MR
               calib_tangents (S.num_samples),
               sample_idx (S.num_samples)
           {
+            if (S.fod_cache)
+              cached = new FODCache::Interp (*S.fod_cache, S.source_voxel);
           }
 
 
@@ -335,6 +344,7 @@ end_init:
           private:
             const Shared& S;
             Interpolator<SourceBufferType::voxel_type>::type source;
+            Ptr<FODCache::Interp> cached;
             value_type calibrate_ratio, half_log_prob0, last_half_log_probN, half_log_prob0_seed;
             size_t mean_sample_num, num_sample_runs, num_truncations;
             value_type max_truncation;
@@ -360,6 +370,8 @@ end_init:
 
             value_type FOD (const Point<value_type>& position, const Point<value_type>& direction)
             {
+              if (cached && cached->set (position))
+                return cached->amplitude (direction);
               if (!get_data (source, position))
                 return NAN;
               return FOD (direction);
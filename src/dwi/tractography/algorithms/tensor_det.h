@@ -23,8 +23,9 @@
 #ifndef __dwi_tractography_algorithms_tensor_det_h__
 #define __dwi_tractography_algorithms_tensor_det_h__
 
+#include <cstring>
+
 #include "point.h"
-#include "math/eigen.h"
 #include "math/least_squares.h"
 #include "dwi/gradient.h"
 #include "dwi/tensor.h"
@@ -80,14 +81,14 @@ namespace MR
 
 
 
+      // The number of streamlines advanced together by next (Tensor_Det* const*, term_t*, size_t)
+      static const size_t batch_size = 8;
+
+
       Tensor_Det (const Shared& shared) :
         MethodBase (shared),
         S (shared),
-        source (S.source_voxel),
-        eig (3),
-        M (3,3),
-        V (3,3),
-        ev (3) { }
+        source (S.source_voxel) { }
 
 
 
@@ -109,6 +110,17 @@ namespace MR
       }
 
 
+      // Advance the streamlines of several instances at once (see Tracking::BatchTracker):
+      //   the tensor fit is performed for all of them together, with the lanes of each SIMD
+      //   vector holding the data for different streamlines
+      static void next (Tensor_Det* const* lanes, term_t* terminations, const size_t num)
+      {
+        for (size_t j = 0; j != num; ++j)
+          terminations[j] = lanes[j]->get_data (lanes[j]->source) ? CONTINUE : Tracking::EXIT_IMAGE;
+        step (lanes, terminations, num);
+      }
+
+
       float get_metric()
       {
         dwi2tensor (S.binv, &values[0]);
@@ -119,26 +131,6 @@ namespace MR
       protected:
       const Shared& S;
       Tracking::Interpolator<SourceBufferType::voxel_type>::type source;
-      Math::Eigen::SymmV<double> eig;
-      Math::Matrix<double> M, V;
-      Math::Vector<double> ev;
-
-      void get_EV ()
-      {
-        M(0,0) = values[0];
-        M(1,1) = values[1];
-        M(2,2) = values[2];
-        M(0,1) = M(1,0) = values[3];
-        M(0,2) = M(2,0) = values[4];
-        M(1,2) = M(2,1) = values[5];
-
-        eig (ev, M, V);
-        Math::Eigen::sort (ev, V);
-
-        dir[0] = V(0,2);
-        dir[1] = V(1,2);
-        dir[2] = V(2,2);
-      }
 
 
       bool do_init()
@@ -148,7 +140,8 @@ namespace MR
         if (tensor2FA (&values[0]) < S.init_threshold)
           return false;
 
-        get_EV();
+        const double D[6] = { values[0], values[1], values[2], values[3], values[4], values[5] };
+        dir = principal_eigenvector (D);
 
         return true;
       }
@@ -156,27 +149,119 @@ namespace MR
 
       term_t do_next()
       {
+        Tensor_Det* lane = this;
+        term_t termination = CONTINUE;
+        step (&lane, &termination, 1);
+        return termination;
+      }
 
-        dwi2tensor (S.binv, &values[0]);
 
-        if (tensor2FA (&values[0]) < S.threshold)
-          return BAD_SIGNAL;
+      // Take a step for each lane whose termination is still CONTINUE, given the DWI signal in its values
+      static void step (Tensor_Det* const* lanes, term_t* terminations, const size_t num)
+      {
+        typedef float vector_type __attribute__ ((vector_size (32)));
+        assert (num && num <= batch_size);
+
+        const Shared& S (lanes[0]->S);
+        const size_t N = S.binv.columns();
+        VLA_MAX (logS, vector_type, N, 256);
+
+        // log-signal, one lane per streamline (zero for those not being fitted):
+        for (size_t i = 0; i != N; ++i) {
+          float l[batch_size];
+          for (size_t j = 0; j != batch_size; ++j) {
+            const float d = (j < num && !terminations[j]) ? lanes[j]->values[i] : 0.0;
+            l[j] = d > 0.0 ? -Math::log (d) : 0.0;
+          }
+          memcpy (&logS[i], l, sizeof (vector_type));
+        }
+
+        // tensor fit, as for dwi2tensor(), but skipping the S0 term:
+        vector_type T[6];
+        for (size_t r = 0; r != 6; ++r) {
+          vector_type t = logS[0] * S.binv (r,0);
+          for (size_t i = 1; i != N; ++i)
+            t += logS[i] * S.binv (r,i);
+          T[r] = t;
+        }
+
+        // FA^2, as for tensor2FA():
+        const vector_type mean = (T[0] + T[1] + T[2]) / 3.0f;
+        const vector_type a0 = T[0] - mean, a1 = T[1] - mean, a2 = T[2] - mean;
+        const vector_type offdiag = 2.0f * (T[3]*T[3] + T[4]*T[4] + T[5]*T[5]);
+        const vector_type num_FA = 1.5f * (a0*a0 + a1*a1 + a2*a2 + offdiag);
+        const vector_type den_FA = T[0]*T[0] + T[1]*T[1] + T[2]*T[2] + offdiag;
+
+        const float threshold2 = Math::pow2 (S.threshold);
+        for (size_t j = 0; j != num; ++j) {
+          if (terminations[j])
+            continue;
+          Tensor_Det& lane (*lanes[j]);
+
+          if (!den_FA[j] || num_FA[j] < threshold2 * den_FA[j]) {
+            terminations[j] = BAD_SIGNAL;
+            continue;
+          }
 
-        Point<value_type> prev_dir = dir;
+          const Point<value_type> prev_dir = lane.dir;
 
-        get_EV();
+          const double D[6] = { T[0][j], T[1][j], T[2][j], T[3][j], T[4][j], T[5][j] };
+          lane.dir = principal_eigenvector (D);
 
-        value_type dot = prev_dir.dot (dir);
-        if (Math::abs (dot) < S.cos_max_angle)
-          return HIGH_CURVATURE;
+          value_type dot = prev_dir.dot (lane.dir);
+          if (Math::abs (dot) < S.cos_max_angle) {
+            terminations[j] = HIGH_CURVATURE;
+            continue;
+          }
+
+          if (dot < 0.0)
+            lane.dir = -lane.dir;
 
-        if (dot < 0.0)
-          dir = -dir;
+          lane.pos += lane.dir * S.step_size;
+        }
+      }
 
-        pos += dir * S.step_size;
 
-        return CONTINUE;
+      // The eigenvector of the largest eigenvalue of the tensor D (xx, yy, zz, xy, xz, yz),
+      //   in closed form: the eigenvalue is found analytically (Smith, Commun. ACM 4:168, 1961),
+      //   and the eigenvector as the largest of the cross products between the rows of D - lambda I.
+      //   If the two largest eigenvalues are equal (an oblate tensor), these cross products all
+      //   vanish, and any direction orthogonal to the remaining non-zero row is an eigenvector
+      static Point<value_type> principal_eigenvector (const double* D)
+      {
+        const double q = (D[0] + D[1] + D[2]) / 3.0;
+        const double a = D[0] - q, b = D[1] - q, c = D[2] - q;
+        const double p = Math::sqrt ((a*a + b*b + c*c + 2.0 * (D[3]*D[3] + D[4]*D[4] + D[5]*D[5])) / 6.0);
+        if (!p)
+          return Point<value_type> (0.0, 0.0, 1.0);
+        const double det = a * (b*c - D[5]*D[5]) - D[3] * (D[3]*c - D[5]*D[4]) + D[4] * (D[3]*D[5] - b*D[4]);
+        const double r = std::max (-1.0, std::min (det / (2.0*p*p*p), 1.0));
+        const double lambda = q + 2.0 * p * Math::cos (Math::acos (r) / 3.0);
+
+        const Point<double> r0 (D[0] - lambda, D[3], D[4]);
+        const Point<double> r1 (D[3], D[1] - lambda, D[5]);
+        const Point<double> r2 (D[4], D[5], D[2] - lambda);
+        Point<double> v (r0.cross (r1));
+        const Point<double> v02 (r0.cross (r2)), v12 (r1.cross (r2));
+        if (v02.norm2() > v.norm2()) v = v02;
+        if (v12.norm2() > v.norm2()) v = v12;
+
+        if (v.norm2() <= 1e-12 * Math::pow2 (Math::pow2 (p))) {
+          Point<double> row (r0);
+          if (r1.norm2() > row.norm2()) row = r1;
+          if (r2.norm2() > row.norm2()) row = r2;
+          // cross with the axis least aligned with the row:
+          const Point<double> mag (Math::abs (row[0]), Math::abs (row[1]), Math::abs (row[2]));
+          const size_t axis = (mag[0] <= mag[1] && mag[0] <= mag[2]) ? 0 : (mag[1] <= mag[2] ? 1 : 2);
+          Point<double> e (0.0, 0.0, 0.0);
+          e[axis] = 1.0;
+          v = row.cross (e);
+          if (!v.norm2())
+            return Point<value_type> (0.0, 0.0, 1.0);
+        }
 
+        v.normalise();
+        return Point<value_type> (v[0], v[1], v[2]);
       }
 
 
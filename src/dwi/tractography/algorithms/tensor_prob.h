@@ -62,6 +62,11 @@ namespace MR
 
 
 
+          // The data are obtained by bootstrap resampling rather than through the interpolator
+          //   used by Tensor_Det's batch kernel, so streamlines are tracked one at a time
+          static const size_t batch_size = 0;
+
+
           Tensor_Prob (const Shared& shared) :
             Tensor_Det (shared),
             S (shared),
@@ -32,6 +32,7 @@
 #include "point.h"
 #include "file/key_value.h"
 #include "file/ofstream.h"
+#include "file/write_behind.h"
 #include "dwi/tractography/file_base.h"
 #include "dwi/tractography/properties.h"
 #include "dwi/tractography/streamline.h"
@@ -292,6 +293,11 @@ namespace MR
           /*! \note \c buffer needs to be greater than \c num_points by one
            * element to add the barrier. */
           void commit (Point<value_type>* data, size_t num_points) {
+            commit (data, num_points, count, total_count);
+          }
+
+          //! write track point data to file, along with the counts given
+          void commit (Point<value_type>* data, size_t num_points, size_t num_tracks, size_t num_total) {
             if (num_points == 0) 
               return;
 
@@ -305,7 +311,7 @@ namespace MR
             out.seekp (prev_barrier_addr, out.beg);
             out.write (reinterpret_cast<const char* const> (data), sizeof(Point<value_type>));
             verify_stream (out);
-            update_counts (out);
+            update_counts (out, num_tracks, num_total);
           }
 
 
@@ -333,6 +339,10 @@ namespace MR
        * to file concurrently. The size of the write-back buffer defaults to
        * 16MB, and can be set in the config file using the
        * TrackWriterBufferSize field (in bytes). 
+       *
+       * Two such buffers are used: once one is full, its contents are written
+       * to file in the background (see File::WriteBehind) while the other is
+       * being filled.
        * */
       template <typename T = float> 
         class Writer : public WriterUnbuffered<T>
@@ -355,15 +365,71 @@ namespace MR
             WriterUnbuffered<T> (file, properties), 
             buffer_capacity (File::Config::get_int ("TrackWriterBufferSize", default_buffer_capacity) / sizeof (Point<value_type>)),
             buffer (new Point<value_type> [buffer_capacity+2]),
-            buffer_size (0) { }
+            spare (new Point<value_type> [buffer_capacity+2]),
+            buffer_size (0),
+            pending (0) { }
 
           //! commits any remaining data to file
+          /*! Errors can't be thrown from a destructor, so are reported here
+           * instead. Either way, the last batch must have been written before
+           * its buffer is freed. */
           ~Writer() {
-            commit();
+            try {
+              commit();
+            }
+            catch (Exception& E) {
+              E.display();
+            }
+            try {
+              File::WriteBehind::wait (pending);
+            }
+            catch (Exception& E) {
+              E.display();
+            }
           }
 
           //! append track to file
           bool operator() (const Streamline<value_type>& tck) {
+            return append (tck, tck.weight);
+          }
+
+          //! append track to file, with unit weight
+          /*! this avoids copying other containers of points into a temporary
+           * Streamline just to write them */
+          bool operator() (const std::vector< Point<value_type> >& tck) {
+            return append (tck, value_type (1.0));
+          }
+
+
+        protected:
+          //! a full buffer of tracks, to be written in the background
+          class Batch : public File::WriteBehind::Job
+          {
+            public:
+              Batch (Writer& writer, Point<value_type>* data, size_t num_points, const std::string& weights) :
+                writer (writer), data (data), num_points (num_points),
+                num_tracks (writer.count), num_total (writer.total_count), weights (weights) { }
+
+              virtual void execute () {
+                writer.WriterUnbuffered<T>::commit (data, num_points, num_tracks, num_total);
+                if (weights.size())
+                  writer.write_weights (weights);
+              }
+
+            protected:
+              Writer& writer;
+              Point<value_type>* const data;
+              const size_t num_points, num_tracks, num_total;
+              const std::string weights;
+          };
+          friend class Batch;
+
+          const size_t buffer_capacity;
+          Ptr<Point<value_type>,true> buffer, spare;
+          size_t buffer_size, pending;
+          std::string weights_buffer;
+
+          bool append (const std::vector< Point<value_type> >& tck, const value_type weight) {
             if (tck.size()) {
               if (buffer_size + tck.size() > buffer_capacity)
                 commit ();
@@ -373,7 +439,7 @@ namespace MR
               add_point (delimiter());
 
               if (weights_name.size())
-                weights_buffer += str (tck.weight) + ' ';
+                weights_buffer += str (weight) + ' ';
 
               ++count;
             }
@@ -381,26 +447,24 @@ namespace MR
             return true;
           }
 
-
-        protected:
-          const size_t buffer_capacity;
-          Ptr<Point<value_type>,true> buffer;
-          size_t buffer_size;
-          std::string weights_buffer;
-
           //! add point to buffer and increment buffer_size accordingly 
           void add_point (const Point<value_type>& p) {
             format_point (p, buffer[buffer_size++]);
           }
 
           void commit () {
-            WriterUnbuffered<T>::commit (buffer, buffer_size);
-            buffer_size = 0;
+            if (!buffer_size && weights_buffer.empty())
+              return;
 
-            if (weights_name.size()) {
-              write_weights (weights_buffer);
-              weights_buffer.clear();
-            }
+            // the previous batch must be written before its buffer is reused:
+            File::WriteBehind::wait (pending);
+            Point<value_type>* full = buffer.release();
+            buffer = spare.release();
+            spare = full;
+
+            pending = File::WriteBehind::submit (new Batch (*this, spare, buffer_size, weights_buffer));
+            buffer_size = 0;
+            weights_buffer.clear();
           }
 
 
@@ -408,7 +472,8 @@ namespace MR
           Writer (const Writer& W) : 
             WriterUnbuffered<value_type> (W),
             buffer_capacity (W.buffer_capacity), 
-            buffer_size (0) {
+            buffer_size (0),
+            pending (0) {
               assert (0); 
             }
       };
@@ -23,6 +23,7 @@
 
 #include "dwi/tractography/file_base.h"
 #include "file/path.h"
+#include "file/write_behind.h"
 
 namespace MR {
   namespace DWI {
@@ -34,6 +35,9 @@ namespace MR {
         properties.clear();
         dtype = DataType::Undefined;
 
+        // the file may still be being written in the background:
+        File::WriteBehind::finish();
+
         const std::string firstline ("mrtrix " + type);
         File::KeyValue kv (file, firstline.c_str());
         std::string data_file;
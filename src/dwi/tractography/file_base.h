@@ -143,8 +143,12 @@ namespace MR
           }
 
           void update_counts (File::OFStream& out) {
+            update_counts (out, count, total_count);
+          }
+
+          void update_counts (File::OFStream& out, size_t num_tracks, size_t num_total) {
             out.seekp (count_offset);
-            out << count << "\ntotal_count: " << total_count << "\nEND\n";
+            out << num_tracks << "\ntotal_count: " << num_total << "\nEND\n";
             verify_stream (out);
           }
       };
@@ -71,6 +71,8 @@ class Upsampler
   private:
     Math::Matrix<T> M;
     mutable Math::Matrix<T> temp, data;
+    // Holds the upsampled track, then the input once exchanged with it, so that both retain their capacity
+    mutable std::vector< Point<T> > buffer;
 
     bool interp_prepare (std::vector< Point<T> >&) const;
     void increment (const Point<T>&) const;
@@ -87,16 +89,17 @@ bool Upsampler<T>::operator() (std::vector< Point<T> >& in) const
 {
   if (!interp_prepare (in))
     return false;
-  std::vector< Point<T> > out;
+  buffer.clear();
+  buffer.reserve ((in.size() - 3) * get_ratio() + 1);
   for (size_t i = 3; i < in.size(); ++i) {
-    out.push_back (in[i-2]);
+    buffer.push_back (in[i-2]);
     increment (in[i]);
     Math::mult (temp, M, data);
     for (size_t row = 0; row != temp.rows(); ++row)
-      out.push_back (Point<T> (temp.row (row)));
+      buffer.push_back (Point<T> (temp.row (row)));
   }
-  out.push_back (in[in.size() - 2]);
-  out.swap (in);
+  buffer.push_back (in[in.size() - 2]);
+  buffer.swap (in);
   return true;
 }
 
@@ -103,10 +103,9 @@ namespace MR
       class Base {
 
         public:
-          Base (const std::string& in, const Math::RNG& seed_rng, const std::string& desc, const size_t attempts) :
+          Base (const std::string& in, const std::string& desc, const size_t attempts) :
             volume (0.0),
             count (0),
-            rng (seed_rng),
             type (desc),
             name (Path::exists (in) ? Path::basename (in) : in),
             max_attempts (attempts) { }
@@ -120,8 +119,10 @@ namespace MR
           const std::string& get_name() const { return name; }
           size_t get_max_attempts() const { return max_attempts; }
 
-          virtual bool get_seed (Point<float>& p) { throw Exception ("Calling empty virtual function Seeder_base::get_seed()!"); return false; }
-          virtual bool get_seed (Point<float>& p, Point<float>& d) { return get_seed (p); }
+          // All random numbers must be drawn from rng, which holds the random
+          //   number stream of the streamline being seeded
+          virtual bool get_seed (Point<float>& p, Math::RNG& rng) { throw Exception ("Calling empty virtual function Seeder_base::get_seed()!"); return false; }
+          virtual bool get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng) { return get_seed (p, rng); }
 
           friend inline std::ostream& operator<< (std::ostream& stream, const Base& B) {
             stream << B.name;
@@ -133,8 +134,7 @@ namespace MR
           // Finite seeds are defined by the number of seeds; non-limited are defined by volume
           float volume;
           uint32_t count;
-          // These are not used by all possible seed classes, but it's easier to have them within the base class anyway
-          Math::RNG rng;
+          // This is not used by all possible seed classes, but it's easier to have it within the base class anyway
           Thread::Mutex mutex;
           const std::string type; // Text describing the type of seed this is
 
@@ -36,7 +36,7 @@ namespace MR
       {
 
 
-        bool Sphere::get_seed (Point<float>& p)
+        bool Sphere::get_seed (Point<float>& p, Math::RNG& rng)
         {
           do {
             p.set (2.0*rng.uniform()-1.0, 2.0*rng.uniform()-1.0, 2.0*rng.uniform()-1.0);
@@ -55,7 +55,7 @@ namespace MR
           mask = NULL;
         }
 
-        bool SeedMask::get_seed (Point<float>& p)
+        bool SeedMask::get_seed (Point<float>& p, Math::RNG& rng)
         {
           Mask::voxel_type seed (*mask);
           do {
@@ -79,7 +79,7 @@ namespace MR
         }
 
 
-        bool Random_per_voxel::get_seed (Point<float>& p)
+        bool Random_per_voxel::get_seed (Point<float>& p, Math::RNG& rng)
         {
 
           if (expired)
@@ -128,7 +128,7 @@ namespace MR
           mask = NULL;
         }
 
-        bool Grid_per_voxel::get_seed (Point<float>& p)
+        bool Grid_per_voxel::get_seed (Point<float>& p, Math::RNG& rng)
         {
 
           if (expired)
@@ -172,8 +172,8 @@ namespace MR
         }
 
 
-        Rejection::Rejection (const std::string& in, const Math::RNG& rng) :
-          Base (in, rng, "rejection sampling", MAX_TRACKING_SEED_ATTEMPTS_RANDOM),
+        Rejection::Rejection (const std::string& in) :
+          Base (in, "rejection sampling", MAX_TRACKING_SEED_ATTEMPTS_RANDOM),
           max (0.0)
         {
 
@@ -226,7 +226,7 @@ namespace MR
         }
 
 
-        bool Rejection::get_seed (Point<float>& p)
+        bool Rejection::get_seed (Point<float>& p, Math::RNG& rng)
         {
 #ifdef REJECTION_SAMPLING_USE_INTERPOLATION
           FloatImage::interp_type interp (image->interp);
@@ -54,8 +54,8 @@ namespace MR
         {
 
           public:
-            Sphere (const std::string& in, const Math::RNG& rng) :
-              Base (in, rng, "sphere", MAX_TRACKING_SEED_ATTEMPTS_RANDOM) {
+            Sphere (const std::string& in) :
+              Base (in, "sphere", MAX_TRACKING_SEED_ATTEMPTS_RANDOM) {
                 std::vector<float> F (parse_floats (in));
                 if (F.size() != 4)
                   throw Exception ("Could not parse seed \"" + in + "\" as a spherical seed point; needs to be 4 comma-separated values (XYZ position, then radius)");
@@ -64,7 +64,7 @@ namespace MR
                 volume = 4.0*M_PI*Math::pow3(rad)/3.0;
               }
 
-            virtual bool get_seed (Point<float>& p);
+            virtual bool get_seed (Point<float>& p, Math::RNG& rng);
 
           private:
             Point<float> pos;
@@ -77,14 +77,14 @@ namespace MR
         {
 
           public:
-            SeedMask (const std::string& in, const Math::RNG& rng) :
-              Base (in, rng, "random seeding mask", MAX_TRACKING_SEED_ATTEMPTS_RANDOM) {
+            SeedMask (const std::string& in) :
+              Base (in, "random seeding mask", MAX_TRACKING_SEED_ATTEMPTS_RANDOM) {
                 mask = Tractography::get_mask (in);
                 volume = get_count (*mask) * mask->vox(0) * mask->vox(1) * mask->vox(2);
               }
 
             virtual ~SeedMask();
-            virtual bool get_seed (Point<float>& p);
+            virtual bool get_seed (Point<float>& p, Math::RNG& rng);
 
           private:
             Mask* mask;
@@ -97,8 +97,8 @@ namespace MR
         {
 
           public:
-            Random_per_voxel (const std::string& in, const Math::RNG& rng, const size_t num_per_voxel) :
-              Base (in, rng, "random per voxel", MAX_TRACKING_SEED_ATTEMPTS_FIXED),
+            Random_per_voxel (const std::string& in, const size_t num_per_voxel) :
+              Base (in, "random per voxel", MAX_TRACKING_SEED_ATTEMPTS_FIXED),
               num (num_per_voxel),
               vox (0, 0, -1),
               inc (0),
@@ -108,7 +108,7 @@ namespace MR
               }
 
             virtual ~Random_per_voxel();
-            virtual bool get_seed (Point<float>& p);
+            virtual bool get_seed (Point<float>& p, Math::RNG& rng);
 
           private:
             Mask* mask;
@@ -125,8 +125,8 @@ namespace MR
         {
 
           public:
-            Grid_per_voxel (const std::string& in, const Math::RNG& rng, const size_t os_factor) :
-              Base (in, rng, "grid per voxel", MAX_TRACKING_SEED_ATTEMPTS_FIXED),
+            Grid_per_voxel (const std::string& in, const size_t os_factor) :
+              Base (in, "grid per voxel", MAX_TRACKING_SEED_ATTEMPTS_FIXED),
               os (os_factor),
               vox (0, 0, -1),
               pos (os, os, os),
@@ -138,7 +138,7 @@ namespace MR
               }
 
             virtual ~Grid_per_voxel();
-            virtual bool get_seed (Point<float>& p);
+            virtual bool get_seed (Point<float>& p, Math::RNG& rng);
 
           private:
             Mask* mask;
@@ -182,9 +182,9 @@ namespace MR
 
 
           public:
-            Rejection (const std::string&, const Math::RNG&);
+            Rejection (const std::string&);
 
-            virtual bool get_seed (Point<float>& p);
+            virtual bool get_seed (Point<float>& p, Math::RNG& rng);
 
           private:
             RefPtr<FloatImage> image;
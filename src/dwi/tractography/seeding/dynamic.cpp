@@ -67,8 +67,8 @@ namespace MR
 
 
 
-      Dynamic::Dynamic (const std::string& in, Image::Buffer<float>& fod_data, const Math::RNG& rng, const DWI::Directions::FastLookupSet& dirs) :
-          Base (in, rng, "dynamic", MAX_TRACKING_SEED_ATTEMPTS_DYNAMIC),
+      Dynamic::Dynamic (const std::string& in, Image::Buffer<float>& fod_data, const DWI::Directions::FastLookupSet& dirs) :
+          Base (in, "dynamic", MAX_TRACKING_SEED_ATTEMPTS_DYNAMIC),
           SIFT::ModelBase<Fixel_TD_seed> (fod_data, dirs),
           total_samples (0),
           total_seeds   (0),
@@ -130,7 +130,7 @@ namespace MR
 
 
 
-      bool Dynamic::get_seed (Point<float>& p, Point<float>& d)
+      bool Dynamic::get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng)
       {
 
         uint64_t samples = 0;
@@ -210,7 +210,7 @@ namespace MR
 
 
 
-        bool WriteKernelDynamic::operator() (const Tracking::GeneratedTrack& in, Tractography::Streamline<>& out)
+        bool WriteKernelDynamic::operator() (Tracking::GeneratedTrack& in, Tractography::Streamline<>& out)
         {
           out.index = writer.count;
           out.weight = 1.0;
@@ -221,7 +221,9 @@ namespace MR
             // Actually need to pass this down the queue so that the seeder thread receives it and knows to terminate
             return true;
           }
-          out = in;
+          // Exchange buffers rather than copying: the track is no longer needed, and both buffers
+          //   are recycled by their queues with their capacity intact
+          out.swap (in);
           return true;
         }
 
@@ -147,11 +147,11 @@ namespace MR
 
 
         public:
-        Dynamic (const std::string&, Image::Buffer<float>&, const Math::RNG&, const DWI::Directions::FastLookupSet&);
+        Dynamic (const std::string&, Image::Buffer<float>&, const DWI::Directions::FastLookupSet&);
 
         ~Dynamic();
 
-        bool get_seed (Point<float>&, Point<float>&);
+        bool get_seed (Point<float>&, Point<float>&, Math::RNG&);
 
         // Although the ModelBase version of this function is OK, the Fixel_TD_seed class
         //   includes the voxel location for easier determination of seed location
@@ -197,8 +197,12 @@ namespace MR
       {
         public:
           WriteKernelDynamic (const Tracking::SharedBase& shared, const std::string& output_file, const DWI::Tractography::Properties& properties) :
-              Tracking::WriteKernel (shared, output_file, properties) { }
-          bool operator() (const Tracking::GeneratedTrack&, Tractography::Streamline<>&);
+              Tracking::WriteKernel (shared, output_file, properties)
+          {
+            // The dynamic seeder responds to tracks in the order they are generated, so there's nothing to gain from re-ordering them
+            in_order = false;
+          }
+          bool operator() (Tracking::GeneratedTrack&, Tractography::Streamline<>&);
       };
 
 
@@ -37,11 +37,11 @@ namespace MR
 
 
 
-      GMWMI::GMWMI (const std::string& in, const Math::RNG& rng, const std::string& anat_path) :
-        Base (in, rng, "GM-WM interface", MAX_TRACKING_SEED_ATTEMPTS_GMWMI),
+      GMWMI::GMWMI (const std::string& in, const std::string& anat_path) :
+        Base (in, "GM-WM interface", MAX_TRACKING_SEED_ATTEMPTS_GMWMI),
         GMWMI_5TT_Wrapper (anat_path),
         ACT::GMWMI_finder (anat_data),
-        init_seeder (in, rng),
+        init_seeder (in),
         perturb_max_step (4.0f * Math::pow (anat_data.vox(0) * anat_data.vox(1) * anat_data.vox(2), (1.0f/3.0f)))
       {
         volume = init_seeder.vol();
@@ -50,13 +50,13 @@ namespace MR
 
 
 
-      bool GMWMI::get_seed (Point<float>& p)
+      bool GMWMI::get_seed (Point<float>& p, Math::RNG& rng)
       {
         Interp interp (interp_template);
         do {
-          init_seeder.get_seed (p);
+          init_seeder.get_seed (p, rng);
           if (find_interface (p, interp)) {
-            if (perturb (p, interp))
+            if (perturb (p, interp, rng))
               return true;
           }
         } while (1);
@@ -65,7 +65,7 @@ namespace MR
 
 
 
-      bool GMWMI::perturb (Point<float>& p, Interp& interp)
+      bool GMWMI::perturb (Point<float>& p, Interp& interp, Math::RNG& rng)
       {
         const Point<float> normal (get_normal (p, interp));
         if (!normal.valid())
@@ -65,16 +65,16 @@ namespace MR
           public:
             using ACT::GMWMI_finder::Interp;
 
-            GMWMI (const std::string&, const Math::RNG&, const std::string&);
+            GMWMI (const std::string&, const std::string&);
 
-            bool get_seed (Point<float>&);
+            bool get_seed (Point<float>&, Math::RNG&);
 
 
           private:
             Rejection init_seeder;
             const float perturb_max_step;
 
-            bool perturb (Point<float>&, Interp&);
+            bool perturb (Point<float>&, Interp&, Math::RNG&);
 
         };
 
@@ -66,17 +66,40 @@ namespace MR
         seeders.clear();
         total_volume = 0.0;
         total_count = 0.0;
+        num_streamlines = 0;
       }
 
 
 
-      bool List::get_seed (Point<float>& p, Point<float>& d)
+      bool List::get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng, size_t& index)
+      {
+
+        if (is_finite()) {
+          // Number-limited seeds are provided in sequence; hold the lock so that the
+          //   pairing of seeds with streamline indices doesn't depend on thread timing
+          Thread::Mutex::Lock lock (mutex);
+          rng.set_stream (num_streamlines);
+          if (!get_seed (p, d, rng))
+            return false;
+          index = num_streamlines++;
+          return true;
+        }
+
+        index = __sync_fetch_and_add (&num_streamlines, 1);
+        rng.set_stream (index);
+        return get_seed (p, d, rng);
+
+      }
+
+
+
+      bool List::get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng)
       {
 
         if (is_finite()) {
 
           for (std::vector<Base*>::iterator i = seeders.begin(); i != seeders.end(); ++i) {
-            if ((*i)->get_seed (p, d))
+            if ((*i)->get_seed (p, d, rng))
               return true;
           }
           p.invalidate();
@@ -85,14 +108,14 @@ namespace MR
         } else {
 
           if (seeders.size() == 1)
-            return seeders.front()->get_seed (p, d);
+            return seeders.front()->get_seed (p, d, rng);
 
           do {
             float incrementer = 0.0;
             const float sample = rng.uniform() * total_volume;
             for (std::vector<Base*>::iterator i = seeders.begin(); i != seeders.end(); ++i) {
               if ((incrementer += (*i)->vol()) > sample)
-                return (*i)->get_seed (p, d);
+                return (*i)->get_seed (p, d, rng);
             }
           } while (1);
           return false;
@@ -50,7 +50,8 @@ namespace MR
         public:
           List() :
             total_volume (0.0),
-            total_count (0) { }
+            total_count (0),
+            num_streamlines (0) { }
 
           ~List()
           {
@@ -63,14 +64,18 @@ namespace MR
 
           void add (Base* const in);
           void clear();
-          bool get_seed (Point<float>& p, Point<float>& d);
+
+          // Get the seed for a new streamline: this assigns it the next streamline index, and
+          //   sets rng to the random number stream for that index before drawing from it
+          bool get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng, size_t& index);
+          // Draw another seed for the current streamline (for seeds that are not number-limited)
+          bool get_seed (Point<float>& p, Point<float>& d, Math::RNG& rng);
 
 
           size_t num_seeds() const { return seeders.size(); }
           const Base* operator[] (const size_t n) const { return seeders[n]; }
           bool is_finite() const { return total_count; }
           uint32_t get_total_count() const { return total_count; }
-          const Math::RNG& get_rng() const { return rng; }
 
 
           friend inline std::ostream& operator<< (std::ostream& stream, const List& S) {
@@ -86,9 +91,10 @@ namespace MR
 
         private:
           std::vector<Base*> seeders;
-          Math::RNG rng;
           float total_volume;
           uint32_t total_count;
+          size_t num_streamlines;
+          Thread::Mutex mutex;
 
       };
 
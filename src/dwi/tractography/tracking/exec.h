@@ -57,8 +57,30 @@ namespace MR
       {
 
 
-        // TODO Try having ACT as a template boolean; allow compiler to optimise out branch statements
+        template <class Method, bool UseACT, bool UseRK4, bool UseROIs> class Tracker;
+        template <class Method, bool UseACT, bool UseROIs> class BatchTracker;
 
+
+        // Algorithms that can advance several streamlines at once (see MethodBase::batch_size)
+        //   are run through the BatchTracker, unless RK4 is in use: this takes several steps of
+        //   the method for each step of the streamline, so can't run in lockstep (nor can ACT
+        //   backtracking, which is handled at run time in Exec::dispatch_rois())
+        template <class Method, bool UseACT, bool UseRK4, bool UseROIs, bool Batch = (Method::batch_size > 0 && !UseRK4)>
+        class SelectTracker {
+          public:
+            typedef Tracker<Method, UseACT, UseRK4, UseROIs> type;
+        };
+
+        template <class Method, bool UseACT, bool UseRK4, bool UseROIs>
+        class SelectTracker<Method, UseACT, UseRK4, UseROIs, true> {
+          public:
+            typedef BatchTracker<Method, UseACT, UseROIs> type;
+        };
+
+
+        // Runs tracking for a given algorithm: the tracking kernel is specialised at compile time
+        //   on which of ACT, RK4 and ROIs are in use, so that the tests for those features that are
+        //   not in use don't appear in the inner loop at all
         template <class Method> class Exec {
 
           public:
@@ -70,107 +92,196 @@ namespace MR
 
                 typename Method::Shared shared (diff_path, properties);
                 WriteKernel writer (shared, destination, properties);
-                Exec<Method> tracker (shared);
-                Thread::run_queue (Thread::multi (tracker), GeneratedTrack(), writer);
+                Run launcher (writer);
+                dispatch (shared, launcher);
 
               } else {
 
                 const std::string& fod_path (properties["seed_dynamic"]);
 
-                typedef Mapping::SetDixel SetDixel;
-                typedef Mapping::TrackMapperBase TckMapper;
-                typedef Seeding::WriteKernelDynamic Writer;
-
                 DWI::Directions::FastLookupSet dirs (1281);
                 Image::Buffer<float> fod_data (fod_path);
-                Seeding::Dynamic* seeder = new Seeding::Dynamic (fod_path, fod_data, properties.seeds.get_rng(), dirs);
+                Seeding::Dynamic* seeder = new Seeding::Dynamic (fod_path, fod_data, dirs);
                 properties.seeds.add (seeder); // List is responsible for deleting this from memory
 
                 typename Method::Shared shared (diff_path, properties);
                 Image::Header H (fod_path);
 
-                Writer       writer  (shared, destination, properties);
-                Exec<Method> tracker (shared);
+                Seeding::WriteKernelDynamic writer (shared, destination, properties);
 
-                TckMapper mapper (H, dirs);
+                Mapping::TrackMapperBase mapper (H, dirs);
                 mapper.set_upsample_ratio (Mapping::determine_upsample_ratio (fod_data, properties, 0.25));
                 mapper.set_use_precise_mapping (true);
 
-                Thread::Queue<GeneratedTrack>           tracking_output_queue;
-                Thread::Queue< Streamline<value_type> > writer_output_queue;
-                Thread::Queue<Mapping::SetDixel>        dixel_queue;
+                RunDynamic launcher (writer, mapper, *seeder);
+                dispatch (shared, launcher);
+
+              }
 
-                Thread::__Source<GeneratedTrack, Exec<Method> >                   q_tracker (tracking_output_queue, tracker);
-                Thread::__Pipe  <GeneratedTrack, Writer, Streamline<value_type> > q_writer  (tracking_output_queue, writer, writer_output_queue);
-                Thread::__Pipe  <Streamline<value_type> , TckMapper, SetDixel>    q_mapper  (writer_output_queue, mapper, dixel_queue);
-                Thread::__Sink  <SetDixel, Seeding::Dynamic>                      q_seeder  (dixel_queue, *seeder);
+            }
 
-                Thread::Array< Thread::__Source<GeneratedTrack, Exec<Method> > >             tracker_array (q_tracker, Thread::number_of_threads());
-                Thread::Array< Thread::__Pipe<Streamline<value_type>, TckMapper, SetDixel> > mapper_array  (q_mapper,  Thread::number_of_threads());
 
-                Thread::Exec tracker_threads (tracker_array, "trackers");
-                Thread::Exec writer_thread   (q_writer,      "writer");
-                Thread::Exec mapper_threads  (mapper_array,  "mappers");
-                Thread::Exec seeder_thread   (q_seeder,      "seeder");
+          private:
 
-              }
+            class Run {
+              public:
+                Run (WriteKernel& writer) : writer (writer) { }
+                template <class TrackerType> void execute (const typename Method::Shared& shared) {
+                  TrackerType tracker (shared);
+                  Thread::run_queue (Thread::multi (tracker), GeneratedTrack(), writer);
+                }
+              private:
+                WriteKernel& writer;
+            };
+
+
+            class RunDynamic {
+              public:
+                RunDynamic (Seeding::WriteKernelDynamic& writer, Mapping::TrackMapperBase& mapper, Seeding::Dynamic& seeder) :
+                  writer (writer), mapper (mapper), seeder (seeder) { }
+                template <class TrackerType> void execute (const typename Method::Shared& shared) {
+
+                  typedef Mapping::SetDixel SetDixel;
+                  typedef Mapping::TrackMapperBase TckMapper;
+                  typedef Seeding::WriteKernelDynamic Writer;
+
+                  TrackerType tracker (shared);
 
+                  Thread::Queue<GeneratedTrack>           tracking_output_queue;
+                  Thread::Queue< Streamline<value_type> > writer_output_queue;
+                  Thread::Queue<Mapping::SetDixel>        dixel_queue;
+
+                  Thread::__Source<GeneratedTrack, TrackerType>                     q_tracker (tracking_output_queue, tracker);
+                  Thread::__Pipe  <GeneratedTrack, Writer, Streamline<value_type> > q_writer  (tracking_output_queue, writer, writer_output_queue);
+                  Thread::__Pipe  <Streamline<value_type> , TckMapper, SetDixel>    q_mapper  (writer_output_queue, mapper, dixel_queue);
+                  Thread::__Sink  <SetDixel, Seeding::Dynamic>                      q_seeder  (dixel_queue, seeder);
+
+                  Thread::Array< Thread::__Source<GeneratedTrack, TrackerType> >               tracker_array (q_tracker, Thread::number_of_threads());
+                  Thread::Array< Thread::__Pipe<Streamline<value_type>, TckMapper, SetDixel> > mapper_array  (q_mapper,  Thread::number_of_threads());
+
+                  Thread::Exec tracker_threads (tracker_array, "trackers");
+                  Thread::Exec writer_thread   (q_writer,      "writer");
+                  Thread::Exec mapper_threads  (mapper_array,  "mappers");
+                  Thread::Exec seeder_thread   (q_seeder,      "seeder");
+
+                }
+              private:
+                Seeding::WriteKernelDynamic& writer;
+                Mapping::TrackMapperBase& mapper;
+                Seeding::Dynamic& seeder;
+            };
+
+
+            template <class Launcher>
+            static void dispatch (const typename Method::Shared& shared, Launcher& launcher)
+            {
+              const bool rois = shared.properties.include.size() || shared.properties.exclude.size() || shared.properties.mask.size();
+              if (shared.is_act())
+                dispatch_rk4<Launcher, true> (shared, launcher, rois);
+              else
+                dispatch_rk4<Launcher, false> (shared, launcher, rois);
             }
 
+            template <class Launcher, bool UseACT>
+            static void dispatch_rk4 (const typename Method::Shared& shared, Launcher& launcher, const bool rois)
+            {
+              if (shared.rk4)
+                dispatch_rois<Launcher, UseACT, true> (shared, launcher, rois);
+              else
+                dispatch_rois<Launcher, UseACT, false> (shared, launcher, rois);
+            }
+
+            template <class Launcher, bool UseACT, bool UseRK4>
+            static void dispatch_rois (const typename Method::Shared& shared, Launcher& launcher, const bool rois)
+            {
+              // ACT backtracking truncates and regrows the streamline, so can't run in lockstep:
+              const bool backtrack = UseACT && shared.act().backtrack();
+              DEBUG ("tracking kernel: ACT " + str(UseACT) + ", RK4 " + str(UseRK4) + ", ROIs " + str(rois)
+                  + ", batch size " + str ((UseRK4 || backtrack) ? size_t(0) : size_t(Method::batch_size)));
+              if (backtrack) {
+                if (rois)
+                  launcher.template execute< Tracker<Method, UseACT, UseRK4, true> > (shared);
+                else
+                  launcher.template execute< Tracker<Method, UseACT, UseRK4, false> > (shared);
+              }
+              else if (rois)
+                launcher.template execute< typename SelectTracker<Method, UseACT, UseRK4, true>::type > (shared);
+              else
+                launcher.template execute< typename SelectTracker<Method, UseACT, UseRK4, false>::type > (shared);
+            }
+
+        };
+
+
 
 
-            Exec (const typename Method::Shared& shared) :
+        template <class Method, bool UseACT, bool UseRK4, bool UseROIs> class Tracker {
+
+          public:
+
+            Tracker (const typename Method::Shared& shared) :
               S (shared),
               method (shared),
               track_excluded (false),
+              seeding_failed (false),
               track_included (S.properties.include.size(), false) { }
 
 
             bool operator() (GeneratedTrack& item) {
               if (!gen_track (item))
                 return false;
-              if (track_rejected (item))
-                item.clear();
-              S.downsampler (item);
+              finish_track (item);
               return true;
             }
 
 
           private:
 
+            template <class, bool, bool> friend class BatchTracker;
+
             const typename Method::Shared& S;
             Method method;
-            bool track_excluded;
+            bool track_excluded, unidirectional, seeding_failed;
             std::vector<bool> track_included;
+            Point<value_type> seed_dir;
 
 
             term_t iterate ()
             {
+              return check_step (next (Feature<UseRK4>()));
+            }
 
-              const term_t method_term = (S.rk4 ? next_rk4() : method.next());
+
+            // The checks following each step of the method, given the termination it returned
+            term_t check_step (const term_t method_term)
+            {
 
               if (method_term)
-                return (S.is_act() && method.act().sgm_depth) ? TERM_IN_SGM : method_term;
+                return (UseACT && method.act().sgm_depth) ? TERM_IN_SGM : method_term;
 
-              if (S.is_act()) {
+              if (UseACT) {
                 const term_t structural_term = method.act().check_structural (method.pos);
                 if (structural_term)
                   return structural_term;
               }
 
-              if (S.properties.mask.size() && !S.properties.mask.contains (method.pos))
-                return EXIT_MASK;
+              if (UseROIs) {
 
-              if (S.properties.exclude.contains (method.pos))
-                return ENTER_EXCLUDE;
+                if (S.properties.mask.size() && !S.properties.mask.contains (method.pos))
+                  return EXIT_MASK;
 
-              // If backtracking is not enabled, add streamline to include regions as it is generated
-              // If it is enabled, this check can only be performed after the streamline is completed
-              if (!(S.is_act() && S.act().backtrack()))
-                S.properties.include.contains (method.pos, track_included);
+                if (S.properties.exclude.contains (method.pos))
+                  return ENTER_EXCLUDE;
 
-              if (S.stop_on_all_include && traversed_all_include_regions())
-                return TRAVERSE_ALL_INCLUDE;
+                // If backtracking is not enabled, add streamline to include regions as it is generated
+                // If it is enabled, this check can only be performed after the streamline is completed
+                if (!(UseACT && S.act().backtrack()))
+                  S.properties.include.contains (method.pos, track_included);
+
+                if (S.stop_on_all_include && traversed_all_include_regions())
+                  return TRAVERSE_ALL_INCLUDE;
+
+              }
 
               return CONTINUE;
 
@@ -179,17 +290,43 @@ namespace MR
 
             bool gen_track (GeneratedTrack& tck)
             {
+              if (!seed_track (tck))
+                return false;
+
+              if (!track_excluded) {
+                gen_track_unidir (tck);
+                if (start_reverse (tck))
+                  gen_track_unidir (tck);
+              }
+
+              return true;
+            }
+
+
+
+            // Start a new track from the next seed: returns false if there are no more seeds.
+            //   If the method can't be initialised at the seed, the track is excluded straight away
+            bool seed_track (GeneratedTrack& tck)
+            {
+              if (seeding_failed)
+                return false;
+
               tck.clear();
               track_excluded = false;
               track_included.assign (track_included.size(), false);
               method.dir.invalidate();
 
-              bool unidirectional = S.unidirectional;
+              unidirectional = S.unidirectional;
 
+              // The seed list assigns the streamline index, and points the random number
+              //   generator at the stream for that index; everything drawn from it from
+              //   here on is therefore the same regardless of the number of threads
+              size_t index;
               if (S.properties.seeds.is_finite()) {
 
-                if (!S.properties.seeds.get_seed (method.pos, method.dir))
+                if (!S.properties.seeds.get_seed (method.pos, method.dir, method.get_rng(), index))
                   return false;
+                tck.set_index (index);
                 if (!method.check_seed() || !method.init()) {
                   track_excluded = true;
                   return true;
@@ -197,37 +334,57 @@ namespace MR
 
               } else {
 
-                for (size_t num_attempts = 0; num_attempts != MAX_NUM_SEED_ATTEMPTS; ++num_attempts) {
-                  if (S.properties.seeds.get_seed (method.pos, method.dir) && method.check_seed() && method.init())
-                    break;
+                bool found = S.properties.seeds.get_seed (method.pos, method.dir, method.get_rng(), index) && method.check_seed() && method.init();
+                tck.set_index (index);
+                for (size_t num_attempts = 1; !found && num_attempts != MAX_NUM_SEED_ATTEMPTS; ++num_attempts) {
+                  found = S.properties.seeds.get_seed (method.pos, method.dir, method.get_rng()) && method.check_seed() && method.init();
                 }
-                if (!method.pos.valid()) {
+                if (!found) {
                   FAIL ("Failed to find suitable seed point after " + str (MAX_NUM_SEED_ATTEMPTS) + " attempts - aborting");
-                  return false;
+                  // This index has been assigned, so the writer will wait for it: pass on an empty
+                  //   track in its place, and stop at the next call
+                  seeding_failed = true;
+                  track_excluded = true;
+                  return true;
                 }
 
               }
 
-              if (S.is_act() && !unidirectional)
+              if (UseACT && !unidirectional)
                 unidirectional = method.act().seed_is_unidirectional (method.pos, method.dir);
 
-              S.properties.include.contains (method.pos, track_included);
+              if (UseROIs)
+                S.properties.include.contains (method.pos, track_included);
 
-              const Point<value_type> seed_dir (method.dir);
+              seed_dir = method.dir;
               tck.push_back (method.pos);
 
-              gen_track_unidir (tck);
+              return true;
 
-              if (!track_excluded && !unidirectional) {
-                tck.reverse();
-                method.pos = tck.back();
-                method.dir = -seed_dir;
-                method.reverse_track ();
-                gen_track_unidir (tck);
-              }
+            }
 
+
+
+            // Once the first half of the track is complete, set up the method to track the
+            //   other half from the seed point: returns false if there is no other half
+            bool start_reverse (GeneratedTrack& tck)
+            {
+              if (track_excluded || unidirectional)
+                return false;
+              tck.reverse();
+              method.pos = tck.back();
+              method.dir = -seed_dir;
+              method.reverse_track ();
               return true;
+            }
+
+
 
+            void finish_track (GeneratedTrack& tck)
+            {
+              if (track_rejected (tck))
+                tck.clear();
+              S.downsampler (tck);
             }
 
 
@@ -236,12 +393,11 @@ namespace MR
             void gen_track_unidir (GeneratedTrack& tck)
             {
 
-              if (S.is_act())
-                method.act().sgm_depth = 0;
+              start_unidir();
 
               term_t termination = CONTINUE;
 
-              if (S.is_act() && S.act().backtrack()) {
+              if (UseACT && S.act().backtrack()) {
 
                 size_t revert_step = 0;
 
@@ -268,15 +424,41 @@ namespace MR
               } else {
 
                 do {
-                  termination = iterate();
-                  if (term_add_to_tck[termination])
-                    tck.push_back (method.pos);
-                  if (!termination && tck.size() >= S.max_num_points)
-                    termination = LENGTH_EXCEED;
+                  termination = advance (tck, next (Feature<UseRK4>()));
                 } while (!termination);
 
               }
 
+              end_unidir (tck, termination);
+
+            }
+
+
+
+            void start_unidir ()
+            {
+              if (UseACT)
+                method.act().sgm_depth = 0;
+            }
+
+
+
+            // Complete a step of the track, given the termination returned by the method
+            term_t advance (GeneratedTrack& tck, const term_t method_term)
+            {
+              term_t termination = check_step (method_term);
+              if (term_add_to_tck[termination])
+                tck.push_back (method.pos);
+              if (!termination && tck.size() >= S.max_num_points)
+                termination = LENGTH_EXCEED;
+              return termination;
+            }
+
+
+
+            void end_unidir (GeneratedTrack& tck, term_t termination)
+            {
+
               apply_priors (termination);
 
               if (termination == EXIT_SGM) {
@@ -300,7 +482,7 @@ namespace MR
                 }
               }
 
-              if (S.is_act() && (termination == ENTER_CGM) && S.act().crop_at_gmwmi())
+              if (UseACT && (termination == ENTER_CGM) && S.act().crop_at_gmwmi())
                 S.act().crop_at_gmwmi (tck);
 
 #ifdef DEBUG_TERMINATIONS
@@ -316,7 +498,7 @@ namespace MR
             void apply_priors (term_t& termination)
             {
 
-              if (S.is_act()) {
+              if (UseACT) {
 
                 switch (termination) {
 
@@ -375,21 +557,21 @@ namespace MR
                 return true;
               }
 
-              if (S.is_act()) {
+              if (UseACT) {
 
                 if (!satisfy_wm_requirement (tck)) {
                   S.add_rejection (ACT_FAILED_WM_REQUIREMENT);
                   return true;
                 }
 
-                if (S.act().backtrack()) {
+                if (UseROIs && S.act().backtrack()) {
                   for (std::vector< Point<float> >::const_iterator i = tck.begin(); i != tck.end(); ++i)
                     S.properties.include.contains (*i, track_included);
                 }
 
               }
 
-              if (!traversed_all_include_regions()) {
+              if (UseROIs && !traversed_all_include_regions()) {
                 S.add_rejection (MISSED_INCLUDE_REGION);
                 return true;
               }
@@ -458,6 +640,11 @@ namespace MR
 
 
 
+            // Only instantiate the RK4 integrator in the kernels that use it
+            template <bool> struct Feature { };
+            term_t next (Feature<false>) { return method.next(); }
+            term_t next (Feature<true>) { return next_rk4(); }
+
             term_t next_rk4()
             {
               term_t termination = CONTINUE;
@@ -502,6 +689,114 @@ namespace MR
 
 
 
+        // Tracks several streamlines at once in each thread, in lockstep, so that the method can
+        //   process the data for all of them together. Each lane holds the state for one streamline
+        //   as a Tracker in its own right, whose method is advanced by the method's batch kernel;
+        //   lanes are refilled with a new seed once their streamline is complete, and completed
+        //   streamlines are returned one at a time.
+        template <class Method, bool UseACT, bool UseROIs> class BatchTracker {
+
+          public:
+
+            BatchTracker (const typename Method::Shared& shared) :
+              lanes (Method::batch_size, Lane (shared)),
+              seeds_exhausted (false)
+            {
+              // see Exec::dispatch_rois():
+              assert (!(UseACT && shared.act().backtrack()));
+            }
+
+
+            bool operator() (GeneratedTrack& item)
+            {
+              Method* methods[Method::batch_size];
+              term_t terminations[Method::batch_size];
+              Lane* tracking[Method::batch_size];
+
+              while (true) {
+
+                for (typename std::vector<Lane>::iterator lane = lanes.begin(); lane != lanes.end(); ++lane) {
+                  if (lane->state == Lane::COMPLETE) {
+                    item.swap (lane->tck);
+                    lane->tracker.finish_track (item);
+                    lane->state = Lane::IDLE;
+                    return true;
+                  }
+                }
+
+                size_t num = 0;
+                for (typename std::vector<Lane>::iterator lane = lanes.begin(); lane != lanes.end(); ++lane) {
+                  if (lane->state == Lane::IDLE && !seeds_exhausted) {
+                    if (!lane->tracker.seed_track (lane->tck)) {
+                      seeds_exhausted = true;
+                      continue;
+                    }
+                    if (lane->tracker.track_excluded) {
+                      lane->state = Lane::COMPLETE;
+                      continue;
+                    }
+                    lane->tracker.start_unidir();
+                    lane->state = Lane::FIRST_HALF;
+                  }
+                  if (lane->state == Lane::FIRST_HALF || lane->state == Lane::SECOND_HALF) {
+                    methods[num] = &lane->tracker.method;
+                    tracking[num++] = &*lane;
+                  }
+                }
+
+                if (!num) {
+                  if (has_complete())
+                    continue;
+                  return false;
+                }
+
+                Method::next (methods, terminations, num);
+
+                for (size_t n = 0; n != num; ++n) {
+                  Lane& lane (*tracking[n]);
+                  const term_t termination = lane.tracker.advance (lane.tck, terminations[n]);
+                  if (termination) {
+                    lane.tracker.end_unidir (lane.tck, termination);
+                    if (lane.state == Lane::FIRST_HALF && lane.tracker.start_reverse (lane.tck)) {
+                      lane.tracker.start_unidir();
+                      lane.state = Lane::SECOND_HALF;
+                    } else {
+                      lane.state = Lane::COMPLETE;
+                    }
+                  }
+                }
+
+              }
+            }
+
+
+          private:
+
+            class Lane {
+              public:
+                Lane (const typename Method::Shared& shared) : tracker (shared), state (IDLE) { }
+                Tracker<Method, UseACT, false, UseROIs> tracker;
+                GeneratedTrack tck;
+                enum { IDLE, FIRST_HALF, SECOND_HALF, COMPLETE } state;
+            };
+
+            std::vector<Lane> lanes;
+            bool seeds_exhausted;
+
+            bool has_complete () const
+            {
+              for (typename std::vector<Lane>::const_iterator lane = lanes.begin(); lane != lanes.end(); ++lane)
+                if (lane->state == Lane::COMPLETE)
+                  return true;
+              return false;
+            }
+
+        };
+
+
+
+
+
 
 
 
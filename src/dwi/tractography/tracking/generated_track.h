@@ -24,6 +24,7 @@
 #define __dwi_tractography_tracking_generated_track_h__
 
 
+#include <algorithm>
 #include <vector>
 
 #include "point.h"
@@ -48,14 +49,18 @@ namespace MR
         typedef std::vector< Point<Tracking::value_type> > BaseType;
 
       public:
-        GeneratedTrack() : seed_index (0) { }
+        GeneratedTrack() : seed_index (0), index (0) { }
+        // Note: the streamline index is retained, so that rejected tracks still have their place in the output order
         void clear() { BaseType::clear(); seed_index = 0; }
         size_t get_seed_index() const { return seed_index; }
+        size_t get_index() const { return index; }
         void reverse() { std::reverse (begin(), end()); seed_index = size()-1; }
         void set_seed_index (const size_t i) { seed_index = i; }
+        void set_index (const size_t i) { index = i; }
+        void swap (GeneratedTrack& that) { BaseType::swap (that); std::swap (seed_index, that.seed_index); std::swap (index, that.index); }
 
       private:
-        size_t seed_index;
+        size_t seed_index, index;
 
     };
 
@@ -92,12 +92,26 @@ namespace MR
             return (!isnan (values[0]));
         }
 
+        template <class VoxelType>
+        inline bool get_data (Image::Interp::LinearVolumes<VoxelType>& source, const Point<value_type>& position)
+        {
+            source.scanner (position);
+            if (!source) return (false);
+            source.get (&values[0]);
+            return (!isnan (values[0]));
+        }
+
         template <class InterpolatorType>
         inline bool get_data (InterpolatorType& source) {
             return (get_data (source, pos));
         }
 
 
+        // Algorithms that can advance several streamlines at once set this to the number of
+        //   streamlines, and provide a static next (Method* const*, term_t*, size_t); they
+        //   are then run through Tracking::BatchTracker
+        static const size_t batch_size = 0;
+
         void reverse_track() { }
         bool init() { return false; }
         term_t next() { return term_t(); }
@@ -114,6 +128,7 @@ namespace MR
 
 
         ACT::ACT_Method_additions& act() const { return *act_method_additions; }
+        Math::RNG& get_rng() { return rng; }
 
         Point<value_type> pos, dir;
 
@@ -71,6 +71,16 @@ namespace MR
             "do NOT pre-compute legendre polynomial values. Warning: "
             "this will slow down the algorithm by a factor of approximately 4.")
 
+      + Option ("fod_cache",
+            "for the iFOD1 & iFOD2 algorithms, cache the FOD amplitudes along a fixed set "
+            "of directions in each voxel visited, and interpolate between these rather than "
+            "evaluating the FOD for every sample. The number of directions (60, 129, 300, "
+            "321, 469, 513 or 1281) sets the accuracy of the interpolation, and the memory "
+            "required per voxel; the total memory used by the cache is limited to the size "
+            "specified in MB.")
+          + Argument ("dirs").type_integer (60, 321, 1281)
+          + Argument ("MB").type_integer (1, 1024, std::numeric_limits<int>::max())
+
       + Option ("power",
             "raise the FOD to the power specified (default is 1/nsamples).")
           + Argument ("value").type_float (1e-6, 1.0, 1e6)
@@ -146,6 +156,12 @@ namespace MR
         opt = get_options ("noprecomputed");
         if (opt.size()) properties["sh_precomputed"] = "0";
 
+        opt = get_options ("fod_cache");
+        if (opt.size()) {
+          properties["fod_cache_dirs"] = std::string (opt[0][0]);
+          properties["fod_cache_mb"] = std::string (opt[0][1]);
+        }
+
         opt = get_options ("power");
         if (opt.size()) properties["fod_power"] = std::string (opt[0][0]);
 
@@ -26,6 +26,7 @@
 
 #include "image/buffer_preload.h"
 #include "image/interp/linear.h"
+#include "image/interp/linear_volumes.h"
 
 
 
@@ -62,6 +63,14 @@ namespace MR
         typedef Image::Interp::Linear<VoxelType> type;
     };
 
+    // The source image is preloaded with the volumes of each voxel stored contiguously
+    //   (see strides_by_volume() in shared.h), so they can all be interpolated at once
+    template <>
+    class Interpolator<SourceBufferType::voxel_type> {
+      public:
+        typedef Image::Interp::LinearVolumes<SourceBufferType::voxel_type> type;
+    };
+
 
 
       }
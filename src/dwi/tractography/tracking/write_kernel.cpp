@@ -34,10 +34,49 @@ namespace MR
       {
 
 
-          bool WriteKernel::operator() (const GeneratedTrack& tck)
+          bool WriteKernel::operator() (GeneratedTrack& tck)
           {
             if (complete())
               return false;
+            if (!in_order) {
+              write (tck);
+              return true;
+            }
+            if (tck.get_index() != next_index) {
+              GeneratedTrack* held = get_buffer();
+              held->swap (tck);
+              pending.insert (std::make_pair (held->get_index(), held));
+              return true;
+            }
+            write (tck);
+            ++next_index;
+            while (pending.size() && pending.begin()->first == next_index && !complete()) {
+              write (*pending.begin()->second);
+              spare.push_back (pending.begin()->second);
+              pending.erase (pending.begin());
+              ++next_index;
+            }
+            return true;
+          }
+
+
+
+          GeneratedTrack* WriteKernel::get_buffer ()
+          {
+            if (spare.size()) {
+              GeneratedTrack* buffer = spare.back();
+              spare.pop_back();
+              return buffer;
+            }
+            GeneratedTrack* buffer = new GeneratedTrack;
+            buffers.push_back (buffer);
+            return buffer;
+          }
+
+
+
+          void WriteKernel::write (const GeneratedTrack& tck)
+          {
             if (tck.size() && seeds) {
               const Point<float>& p = tck[tck.get_seed_index()];
               (*seeds) << str(writer.count) << "," << str(tck.get_seed_index()) << "," << str(p[0]) << "," << str(p[1]) << "," << str(p[2]) << ",\n";
@@ -48,7 +87,6 @@ namespace MR
                   writer.total_count, writer.count,
                   (int(100.0 * std::max (writer.total_count/float(S.max_num_attempts), writer.count/float(S.max_num_tracks)))));
             }
-            return true;
           }
 
 
@@ -23,6 +23,7 @@
 #ifndef __dwi_tractography_tracking_write_kernel_h__
 #define __dwi_tractography_tracking_write_kernel_h__
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -58,7 +59,9 @@ namespace MR
               const std::string& output_file,
               const DWI::Tractography::Properties& properties) :
                 S (shared),
-                writer (output_file, properties)
+                writer (output_file, properties),
+                in_order (true),
+                next_index (0)
           {
             DWI::Tractography::Properties::const_iterator seed_output = properties.find ("seed_output");
             if (seed_output != properties.end()) {
@@ -69,6 +72,10 @@ namespace MR
 
           ~WriteKernel ()
           {
+            // Should only be non-empty if tracking was aborted
+            for (std::map<size_t, GeneratedTrack*>::const_iterator i = pending.begin(); i != pending.end() && !complete(); ++i)
+              write (*i->second);
+            DEBUG ("track writer: " + str (buffers.size()) + " buffers allocated for tracks received out of order");
             if (App::log_level > 0)
               fprintf (stderr, "\r%8zu generated, %8zu selected    [100%%]\n", writer.total_count, writer.count);
             if (seeds) {
@@ -79,7 +86,8 @@ namespace MR
           }
 
 
-          bool operator() (const GeneratedTrack&);
+          // Non-const: a track that can't be written yet is swapped into a spare buffer rather than copied
+          bool operator() (GeneratedTrack&);
 
           bool complete() const { return (writer.count >= S.max_num_tracks || writer.total_count >= S.max_num_attempts); }
 
@@ -90,6 +98,17 @@ namespace MR
           Ptr<File::OFStream> seeds;
           IntervalTimer timer;
 
+          // Tracks arriving out of order are held back until all those with lower indices have been written;
+          //   the buffers holding them are recycled once written, so keep their capacity
+          bool in_order;
+          size_t next_index;
+          std::map<size_t, GeneratedTrack*> pending;
+          VecPtr<GeneratedTrack> buffers;
+          std::vector<GeneratedTrack*> spare;
+
+          void write (const GeneratedTrack&);
+          GeneratedTrack* get_buffer();
+
       };
 
 